@@ -0,0 +1,360 @@
+#include "../core/prelude.h"
+#include "../core/str.h"
+#include "../core/vec.h"
+
+#include "../compile/context.h"
+
+#include <chrono>
+
+// Compiler throughput benchmark
+// Generates programs of a few shapes at growing sizes and times every phase on them. Throughput is lines/sec for the
+// tokenizer and the parser (which runs the peepholes as it builds the graph), nodes built by the parser per second for
+// the optimizer, and live nodes per second for everything after it. A phase that scales worse than linearly shows up
+// as a drop in throughput between the sizes of the same shape.
+// Then the tokenizer alone runs over a few megabytes of source, in MB/s.
+// The results are compared against a baseline (`src/bench/baseline.json`, written by `--save`); anything more than
+// `SLOWER` times slower is flagged. The numbers only mean something on the machine they were measured on, so a change
+// that adds a workload should use `--add`, which keeps every result the baseline already has and appends the new ones.
+//
+// usage: bench [--save | --add] [baseline.json]
+
+#define REPS 3 // every measurement is the best of this many runs
+#define SLOWER 1.25
+#define MIN_SECONDS 1e-4 // anything quicker is too noisy to flag
+
+/* Generators */
+
+// `n` variables, each defined from the previous one, then all of them updated again
+Str gen_vars(u32 n, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let v0: i64 = arg;\n"_s);
+    for(u32 i = 1; i < n; i++) src.push_slice(str::cat(arena, "let v"_s, str::from_int(i, arena), ": i64 = v"_s, str::from_int(i-1, arena), " + "_s, str::from_int(i, arena), ";\n"_s));
+    for(u32 i = 1; i < n; i++) src.push_slice(str::cat(arena, "v"_s, str::from_int(i, arena), " = v"_s, str::from_int(i, arena), " + v"_s, str::from_int(i/2, arena), ";\n"_s));
+    src.push_slice(str::cat(arena, "return v"_s, str::from_int(n-1, arena), ";\n"_s));
+    return src.full_slice();
+}
+
+// `if`s nested `depth` deep, each updating a couple of variables
+Str gen_ifs(u32 depth, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let x: i64 = 0;\nlet y: i64 = arg;\n"_s);
+    for(u32 i = 0; i < depth; i++) {
+        Str k = str::from_int(i, arena);
+        src.push_slice(str::cat(arena, "if(y < "_s, k, ") { x = x + "_s, k, "; } else { y = y - 1; };\n"_s));
+        src.push_slice(str::cat(arena, "if("_s, k, " < y) {\nx = x + y;\n"_s));
+    }
+    for(u32 i = 0; i < depth; i++) src.push_slice("};\n"_s);
+    src.push_slice("return x + y;\n"_s);
+    return src.full_slice();
+}
+
+// `while`s nested `depth` deep; with `arg = 1` every loop runs once
+Str gen_whiles(u32 depth, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let s: i64 = 0;\n"_s);
+    for(u32 i = 0; i < depth; i++) {
+        Str k = str::from_int(i, arena);
+        src.push_slice(str::cat(arena, "let i"_s, k, ": i64 = 0;\nwhile(i"_s, k, " < arg) {\ni"_s, k, " = i"_s, k, " + 1;\ns = s + i"_s, k, ";\n"_s));
+    }
+    for(u32 i = 0; i < depth; i++) src.push_slice("};\n"_s);
+    src.push_slice("return s;\n"_s);
+    return src.full_slice();
+}
+
+// `n` lines of long additive expressions
+Str gen_chain(u32 n, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let x: i64 = arg;\n"_s);
+    for(u32 i = 0; i < n; i++) {
+        src.push_slice("x = x"_s);
+        for(u32 j = 0; j < 16; j++) {
+            src.push_slice(" + "_s);
+            if(j % 4 == 3) src.push_slice("arg"_s);
+            else src.push_slice(str::from_int(i*16 + j + 1, arena));
+        }
+        src.push_slice(";\n"_s);
+    }
+    src.push_slice("return x;\n"_s);
+    return src.full_slice();
+}
+
+// `n` lines of expressions mixing every precedence level and unary minus
+Str gen_exprs(u32 n, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let x: i64 = arg;\nlet y: i64 = 1;\n"_s);
+    for(u32 i = 0; i < n; i++) {
+        Str k = str::from_int(i % 97 + 2, arena);
+        src.push_slice(str::cat(arena, "y = (x * "_s, k, " - arg) / 7 + -y * 2 - x % "_s, k, " + arg * arg - 1;\n"_s));
+        src.push_slice(str::cat(arena, "x = y - x * -3 < arg + "_s, k, " == x > y - 1;\n"_s));
+    }
+    src.push_slice("return x + y;\n"_s);
+    return src.full_slice();
+}
+
+// `n` pairs of loops, one filling an array and one summing it
+Str gen_arrays(u32 n, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let arr: i64[64];\nlet i: i64 = 0;\nlet sum: i64 = 0;\n"_s);
+    for(u32 k = 0; k < n; k++) {
+        src.push_slice(str::cat(arena, "i = 0;\nwhile(i < 64) {\narr[i] = i + "_s, str::from_int(k, arena), ";\ni = i + 1;\n};\n"_s));
+        src.push_slice("i = 0;\nwhile(i < 64) {\nsum = sum + arr[i];\ni = i + 1;\n};\n"_s);
+    }
+    src.push_slice("return sum;\n"_s);
+    return src.full_slice();
+}
+
+// a table of `n` big decimal and hex constants, summed
+// no floats: the parser rejects them, since nothing handles them yet
+Str gen_consts(u32 n, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    src.push_slice("let sum: i64 = arg;\n"_s);
+    char buf[256];
+    for(u32 k = 0; k < n; k++) {
+        u64 v = (k + 1) * 0x9E3779B97F4A7C15ULL >> 8;
+        std::snprintf(buf, sizeof(buf), "let d%u: i64 = %llu;\nlet h%u: i64 = 0x%llx;\n", k, (unsigned long long) v, k, (unsigned long long) (v >> 4));
+        src.push_slice(str::from_cstr(buf));
+        std::snprintf(buf, sizeof(buf), "sum = sum + d%u + h%u;\n", k, k);
+        src.push_slice(str::from_cstr(buf));
+    }
+    src.push_slice("return sum;\n"_s);
+    return src.full_slice();
+}
+
+// about `bytes` of indented statements; with `comments`, most lines end in a comment and there are comment blocks
+// nothing is parsed, so they don't have to make sense as a program
+Str gen_lex(usize bytes, bool comments, mem::Arena& arena) {
+    Vec<u8> src = Vec<u8>::create(arena);
+    for(u32 i = 0; src.size < bytes; i++) {
+        mem::Scratch scratch; // for the temporary strings
+        mem::Arena& tmp = *scratch.arena;
+        Str a = str::from_int(i % 1000, tmp), b = str::from_int((i * 7) % 1000, tmp);
+        src.push_slice(str::cat(tmp, "    let v"_s, a, ": i64 = v"_s, b, " + "_s, str::from_int(i, tmp), " * arg;"_s));
+        src.push_slice(comments ? "    # running total, see above\n"_s : "\n"_s);
+        if(comments && i % 16 == 0) src.push_slice("\n    ## a comment block\n       that spans # a few\n       lines ##\n\n"_s);
+    }
+    return src.full_slice();
+}
+
+struct Workload {
+    char const* name;
+    Str (*generate)(u32, mem::Arena&);
+    u32 sizes[3];
+    bool evaluate; // the evaluator doesn't do loads and stores
+};
+
+/* Measuring */
+
+enum Stage { Tokenize, Parse, Optimize, Idom, Gcm, Evaluate, Codegen, STAGES };
+char const* stage_names[STAGES] = { "tokenize", "parse", "optimize", "idom", "gcm", "evaluate", "codegen" };
+
+f64 seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+}
+
+u32 count_lines(Str src) {
+    u32 lines = 0;
+    for(usize i = 0; i < src.size; i++) lines += src[i] == '\n';
+    return lines;
+}
+
+struct Counts {
+    u32 built; // nodes made by the parser (and its peepholes)
+    u32 live; // nodes left after compaction
+};
+
+// run the whole pipeline once and put the seconds each stage took in `secs`
+Counts run_once(Str src, bool evaluate, f64* secs) {
+    Counts counts {};
+    CompilationContext ctx = CompilationContext::create();
+    ctx.enter();
+
+    auto start = std::chrono::steady_clock::now();
+    TokenStream tokens = TokenStream::lex(src);
+    secs[Tokenize] = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    Parser p = Parser::create(tokens);
+    if(!p.parse()) {
+        std::cout << "parse error: " << p.diagnostics[0].message << std::endl;
+        std::exit(1);
+    }
+    SCOPE_NODE->pop();
+    secs[Parse] = seconds_since(start);
+    counts.built = Node::uid_counter;
+
+    start = std::chrono::steady_clock::now();
+    sccp::run(START_NODE, STOP_NODE);
+    peeps::run(START_NODE);
+    compact::run(START_NODE, STOP_NODE, ctx.compact_arena);
+    secs[Optimize] = seconds_since(start);
+    counts.live = Node::uid_counter;
+
+    start = std::chrono::steady_clock::now();
+    if(evaluate) Evaluator::create_and_run(START_NODE, 1, 100000);
+    secs[Evaluate] = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    node::compute_idom();
+    secs[Idom] = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    gcm::build((NodeStart*) START_NODE, (NodeStop*) STOP_NODE);
+    secs[Gcm] = seconds_since(start);
+
+    // there's no instruction selection yet; the scheduled listing is the closest thing to emitting code
+    start = std::chrono::steady_clock::now();
+    Str out = compile::dump(START_NODE);
+    secs[Codegen] = seconds_since(start);
+    if(out.size == 0) std::printf("\n"); // keep it alive
+    return counts;
+}
+
+// seconds it takes to lex all of `src` into a `TokenStream`
+f64 lex_once(Str src) {
+    CompilationContext ctx = CompilationContext::create();
+    ctx.enter(); // identifiers are interned
+    mem::Scratch scratch; // the same memory every time, so the page faults are only in the first run
+    auto start = std::chrono::steady_clock::now();
+    TokenStream tokens = TokenStream::lex(src, *scratch.arena);
+    f64 secs = seconds_since(start);
+    if(tokens.size() == 0) std::printf("\n"); // keep it alive
+    return secs;
+}
+
+/* Baseline */
+
+struct Result {
+    Str key; // "<workload>/<size>/<stage>"
+    f64 value; // per second
+};
+
+// the baseline is written by `save` with one "key": value pair per line, so it's read back the same way
+Vec<Result> load(char const* path, mem::Arena& arena) {
+    Vec<Result> results = Vec<Result>::create(arena);
+    FILE* f = std::fopen(path, "r");
+    if(f == nullptr) return results;
+    char line[256];
+    while(std::fgets(line, sizeof(line), f) != nullptr) {
+        char key[128];
+        f64 value;
+        if(std::sscanf(line, " \"%127[^\"]\": %lf", key, &value) != 2) continue;
+        results.push(Result { .key = str::clone_cstr(key, std::strlen(key), arena), .value = value });
+    }
+    std::fclose(f);
+    return results;
+}
+
+void save(char const* path, Vec<Result>& results) {
+    FILE* f = std::fopen(path, "w");
+    if(f == nullptr) {
+        std::cout << "could not write " << path << std::endl;
+        return;
+    }
+    std::fprintf(f, "{\n");
+    for(usize i = 0; i < results.size; i++) {
+        std::fprintf(f, "    \"%.*s\": %.1f%s\n", (int) results[i].key.size, (char const*) results[i].key.data, results[i].value, i + 1 < results.size ? "," : "");
+    }
+    std::fprintf(f, "}\n");
+    std::fclose(f);
+}
+
+// add a result and compare it to the baseline; returns the mark to print next to it
+char record(char const* key, f64 per_sec, f64 secs, Vec<Result>& baseline, Vec<Result>& results, u32& regressions) {
+    Str k = str::clone_cstr(key, std::strlen(key), *results.arena);
+    results.push(Result { .key = k, .value = per_sec });
+    for(Result& b : baseline) {
+        if(b.key == k && secs >= MIN_SECONDS && per_sec * SLOWER < b.value) {
+            regressions++;
+            return '!';
+        }
+    }
+    return ' ';
+}
+
+int main(int argc, char* argv[]) {
+    bool save_baseline = false;
+    bool add_to_baseline = false;
+    char const* baseline_path = "src/bench/baseline.json";
+    for(i32 i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--save") == 0) save_baseline = true;
+        else if(std::strcmp(argv[i], "--add") == 0) add_to_baseline = true;
+        else baseline_path = argv[i];
+    }
+
+    mem::Arena arena = mem::Arena::create_chunked(1 MB);
+    Vec<Result> baseline = load(baseline_path, arena);
+    Vec<Result> results = Vec<Result>::create(arena);
+    u32 regressions = 0;
+
+    Workload workloads[] = {
+        { "vars", gen_vars, { 250, 1000, 4000 }, true },
+        { "ifs", gen_ifs, { 25, 100, 400 }, true },
+        { "whiles", gen_whiles, { 10, 40, 160 }, true },
+        { "chain", gen_chain, { 25, 50, 100 }, true }, // reassociation makes these quadratic
+        { "arrays", gen_arrays, { 10, 40, 160 }, false }, // gcm still slows down as loops are added (optimize did too, once)
+        { "consts", gen_consts, { 250, 1000, 4000 }, true },
+        { "exprs", gen_exprs, { 250, 1000, 4000 }, false }, // the evaluator redoes shared subexpressions, exponential here
+    };
+
+    std::printf("%-8s %6s %7s %7s %7s", "program", "size", "lines", "built", "live");
+    for(u32 s = 0; s < STAGES; s++) std::printf(" %12s", stage_names[s]);
+    std::printf("\n");
+    for(Workload& w : workloads) {
+        for(u32 size : w.sizes) {
+            Str src = Source::from_str(w.generate(size, arena), arena).text;
+            u32 lines = count_lines(src);
+            f64 best[STAGES];
+            Counts counts {};
+            for(u32 s = 0; s < STAGES; s++) best[s] = 1e30;
+            for(u32 r = 0; r < REPS; r++) {
+                f64 secs[STAGES] = {};
+                counts = run_once(src, w.evaluate, secs);
+                for(u32 s = 0; s < STAGES; s++) best[s] = min(best[s], secs[s]);
+            }
+
+            std::printf("%-8s %6u %7u %7u %7u", w.name, size, lines, counts.built, counts.live);
+            for(u32 s = 0; s < STAGES; s++) {
+                if(s == Evaluate && !w.evaluate) { std::printf(" %12s", "-"); continue; }
+                u32 work = s <= Parse ? lines : s == Optimize ? counts.built : counts.live;
+                f64 per_sec = work / max(best[s], 1e-9);
+                char key[128];
+                std::snprintf(key, sizeof(key), "%s/%u/%s", w.name, size, stage_names[s]);
+                char mark = record(key, per_sec, best[s], baseline, results, regressions);
+                std::printf(" %11.3gM%c", per_sec / 1e6, mark);
+            }
+            std::printf("\n");
+        }
+    }
+    std::printf("(millions of lines/s for tokenize and parse, built nodes/s for optimize, live nodes/s for the rest)\n");
+
+    std::printf("\n%-8s %6s %12s\n", "lexing", "MB", "MB/s");
+    for(bool comments : { false, true }) {
+        Str src = Source::from_str(gen_lex(16 MB, comments, arena), arena).text;
+        f64 secs = 1e30;
+        for(u32 r = 0; r < REPS; r++) secs = min(secs, lex_once(src));
+        f64 mb_per_sec = src.size / 1e6 / secs;
+        char key[128];
+        std::snprintf(key, sizeof(key), "lex/%s/MBps", comments ? "comments" : "code");
+        char mark = record(key, mb_per_sec, secs, baseline, results, regressions);
+        std::printf("%-8s %6.1f %11.1f%c\n", comments ? "comments" : "code", src.size / 1e6, mb_per_sec, mark);
+    }
+
+    if(save_baseline) {
+        save(baseline_path, results);
+        std::printf("saved the baseline to %s\n", baseline_path);
+    } else if(add_to_baseline) {
+        u32 added = 0;
+        for(Result& r : results) {
+            bool known = false;
+            for(Result& b : baseline) known = known || b.key == r.key;
+            if(!known) { baseline.push(r); added++; }
+        }
+        save(baseline_path, baseline);
+        std::printf("added %u results to %s\n", added, baseline_path);
+    } else if(baseline.empty()) {
+        std::printf("no baseline at %s; run with --save to make one\n", baseline_path);
+    } else {
+        std::printf("%u results more than %.2fx slower than %s (marked with !)\n", regressions, SLOWER, baseline_path);
+    }
+    return 0;
+}
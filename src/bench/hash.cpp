@@ -0,0 +1,115 @@
+#include "../core/prelude.h"
+#include "../core/mem.h"
+#include "../core/str.h"
+#include "../core/map.h"
+
+#include <chrono>
+
+// Hash quality microbenchmark
+// For a few kinds of keys the compiler actually uses, compare the old hashes (identity for ints and pointers, xor/rotl
+// for strings and types) with the current ones, by the length of the collision chains they produce in a table.
+
+#define KEYS 65536
+
+namespace old_hash {
+    u64 ptr(void* p) { return (u64) p; }
+    u64 int_(u64 i) { return i; }
+    u64 str(Str s) {
+        u64 acc_hash = 0;
+        for(usize i = 0; i < s.size; i++) acc_hash ^= std::rotl((u64) s.data[i], i);
+        return acc_hash;
+    }
+    // `type::hash` of a known int (TypeI::Known = 1, TypeT::Int = 3)
+    u64 type_int(i64 val) {
+        return (1 ^ 3 * 3) ^ std::rotl((u64) val, 8) ^ std::rotl((u64) val, 16);
+    }
+}
+
+namespace new_hash {
+    u64 ptr(void* p) { return hash::from(p); }
+    u64 int_(u64 i) { return hash::from(i); }
+    u64 str(Str s) { return s.hash(); }
+    u64 type_int(i64 val) {
+        return hash::combine(hash::combine(hash::from(1), hash::from(3)), hash::from(val), hash::from(val));
+    }
+}
+
+struct Chains {
+    f64 avg; // average length of the chain a key is in
+    u32 max;
+};
+
+// separate chaining into `buckets` buckets, either by `% buckets` or `& (buckets-1)`
+Chains chains(u64* hashes, u32 n, u32 buckets, bool pow2) {
+    mem::Arena arena = mem::Arena::create(buckets * sizeof(u32) + 64);
+    u32* count = arena.alloc<u32>(buckets);
+    mem::zero(count, buckets);
+    for(u32 i = 0; i < n; i++) count[pow2 ? hashes[i] & (buckets - 1) : hashes[i] % buckets]++;
+    u64 sum = 0; u32 max = 0;
+    for(u32 b = 0; b < buckets; b++) {
+        sum += (u64) count[b] * count[b];
+        max = std::max(max, count[b]);
+    }
+    return Chains { .avg = (f64) sum / n, .max = max };
+}
+
+template <typename F, typename G>
+void report(char const* name, u32 n, F&& old_h, G&& new_h) {
+    mem::Arena arena = mem::Arena::create(2 * n * sizeof(u64) + 64);
+    u64* olds = arena.alloc<u64>(n);
+    u64* news = arena.alloc<u64>(n);
+    for(u32 i = 0; i < n; i++) { olds[i] = old_h(i); news[i] = new_h(i); }
+    u32 prime = next_prime_size(n * 4 / 3); // what the old tables would grow to
+    u32 pow2 = n * 2; // 50% load
+    Chains a = chains(olds, n, prime, false);
+    Chains b = chains(olds, n, pow2, true);
+    Chains c = chains(news, n, pow2, true);
+    std::printf("%-12s | old %% prime: avg %6.2f max %5u | old & pow2: avg %6.2f max %5u | new & pow2: avg %6.2f max %5u\n",
+        name, a.avg, a.max, b.avg, b.max, c.avg, c.max);
+}
+
+// `HMap` keyed by a u64 with a chosen hash
+template <bool strong>
+struct Key {
+    u64 v;
+    bool operator==(Key const&) const = default;
+    u64 hash() { return strong ? hash::from(v) : v; }
+};
+
+template <bool strong>
+f64 time_map(u64* keys, u32 n) {
+    mem::Arena arena = mem::Arena::create_chunked(1 MB);
+    HMap<Key<strong>, u64> map = HMap<Key<strong>, u64>::create(&arena);
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < n; i++) map.add(Key<strong> { keys[i] }, i);
+    u64 acc = 0;
+    for(u32 r = 0; r < 8; r++)
+        for(u32 i = 0; i < n; i++) acc += map[Key<strong> { keys[i] }];
+    auto end = std::chrono::steady_clock::now();
+    if(acc == 1) std::printf("\n"); // keep the lookups alive
+    return std::chrono::duration<f64, std::nano>(end - start).count() / (9.0 * n);
+}
+
+int main(int argc, char* argv[]) {
+    mem::Arena arena = mem::Arena::create_chunked(1 MB);
+
+    // nodes are ~100 bytes and allocated back to back
+    u8** ptrs = arena.alloc<u8*>(KEYS);
+    for(u32 i = 0; i < KEYS; i++) ptrs[i] = arena.alloc<u8>(96);
+    Str* names = arena.alloc<Str>(KEYS);
+    for(u32 i = 0; i < KEYS; i++) {
+        char buf[16];
+        u32 len = std::snprintf(buf, sizeof(buf), "v%u", i);
+        names[i] = str::clone_cstr(buf, len, arena);
+    }
+
+    std::printf("collision chains for %u keys (avg = expected chain length seen by a key; 1.0 = no collisions, a uniform hash gives 1 + load)\n", KEYS);
+    report("pointers", KEYS, [&](u32 i) { return old_hash::ptr(ptrs[i]); }, [&](u32 i) { return new_hash::ptr(ptrs[i]); });
+    report("ints x8", KEYS, [&](u32 i) { return old_hash::int_((u64) i * 8); }, [&](u32 i) { return new_hash::int_((u64) i * 8); });
+    report("identifiers", KEYS, [&](u32 i) { return old_hash::str(names[i]); }, [&](u32 i) { return new_hash::str(names[i]); });
+    report("int types", KEYS, [&](u32 i) { return old_hash::type_int(i); }, [&](u32 i) { return new_hash::type_int(i); });
+
+    u64* keys = arena.alloc<u64>(KEYS);
+    for(u32 i = 0; i < KEYS; i++) keys[i] = (u64) ptrs[i];
+    std::printf("HMap add + lookups, pointer keys: identity %.1f ns/op, mixed %.1f ns/op\n", time_map<false>(keys, KEYS), time_map<true>(keys, KEYS));
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/mem.h"
+#include "../core/str.h"
+#include "../core/profile.h"
+
+#include "../son/parser.h"
+#include "../son/iterative_peephole.h"
+#include "../son/sccp.h"
+#include "../son/compact.h"
+#include "../son/global_code_motion.h"
+
+#include "dump.h"
+#include "dot.h"
+#include "graph_evaluator.h"
+
+// Everything needed to compile one source file
+// The graph, the type pool, the symbol table and the rest of the compiler's globals are thread_local; `compile` points
+// the calling thread's globals at this context's arenas and runs all of the phases. So any number of contexts can
+// compile at once, as long as each one is on its own thread. Anything the phases leave on `default_arena` is freed when
+// `compile` returns; the graph stays on the context's arenas until the context goes out of scope.
+struct CompilationContext {
+    mem::Arena node_arena;
+    mem::Arena compact_arena; // becomes the node arena after `compact::run`
+    mem::Arena scope_arena;
+    mem::Arena type_arena;
+
+    struct Options {
+        char const* program_input; // nullable; run the evaluator with this as `arg`
+        char const* dot_path; // nullable; write the graph there in the dot format
+    };
+
+    static CompilationContext create() {
+        return CompilationContext {
+            .node_arena = mem::Arena::create_chunked(1 MB),
+            .compact_arena = mem::Arena::create_chunked(1 MB),
+            .scope_arena = mem::Arena::create_chunked(256 KB),
+            .type_arena = mem::Arena::create_chunked(256 KB),
+        };
+    }
+
+    // have the profiler count these arenas (and `default_arena`) towards every phase
+    void track() {
+        for(mem::Arena* a : { &node_arena, &compact_arena, &scope_arena, &type_arena, &default_arena }) profile::track(*a);
+    }
+
+    // set up the calling thread's globals for a new program
+    void enter() {
+        type::pool = TypePool::create(type_arena);
+        sym::table = SymbolTable::create(scope_arena);
+        Node::init(node_arena);
+        Type* inputs[2] = { type::pool.ctrl, (Type*) type::pool.get_bottom(TypeT::Int) };
+        START_NODE = NodeStart::create(Slice<Type*>::from_ptr(inputs, 2));
+        STOP_NODE = NodeStop::create();
+        SCOPE_NODE = NodeScope::create(scope_arena, NodeProj::create(0, START_NODE, true));
+        SCOPE_NODE->define("arg"_s, NodeProj::create(1, START_NODE, false));
+        SCOPE_NODE->define("$1"_s, NodeConst::create(type::pool.mem(type::pool.int_const(0)))); // manually load the alias class $1
+        BREAK_SCOPE_NODE = CONTINUE_SCOPE_NODE = nullptr;
+    }
+
+    // compile `src` on the calling thread, writing everything it reports to `out`; false if it didn't parse
+    bool compile(Str src, Options const& options, std::ostream& out) {
+        mem::Arena::Mark mark = default_arena.mark();
+        this->enter();
+        TokenStream tokens;
+        {
+            profile::Phase phase("lex"_s);
+            tokens = TokenStream::lex(src);
+        }
+        bool ok = this->run(tokens, options, out, [&](u64 at, u8* buf, usize size) -> usize {
+            if(at >= src.size) return 0;
+            size = min(size, (usize) (src.size - at));
+            mem::copy(buf, src.data + at, size);
+            return size;
+        });
+        this->leave(mark);
+        return ok;
+    }
+
+    // same, but the source is read from `fd` a chunk at a time as it's parsed (see `ChunkReader`); closes `fd`
+    // lexing happens during the parse phase then
+    bool compile(i32 fd, Options const& options, std::ostream& out) {
+        mem::Arena::Mark mark = default_arena.mark();
+        this->enter();
+        ChunkReader reader = ChunkReader::create(fd);
+        TokenStream tokens = TokenStream::stream(&reader, scope_arena);
+        // the chunks with errors in them are gone by the time they're printed, so those lines are read again
+        bool ok = this->run(tokens, options, out, [&](u64 at, u8* buf, usize size) -> usize {
+            i64 got = ::pread(reader.fd, buf, size, at);
+            return got < 0 ? 0 : got;
+        });
+        reader.close();
+        this->leave(mark);
+        return ok;
+    }
+
+    void leave(mem::Arena::Mark mark) {
+        default_arena.rewind(mark);
+        node::cfg_size = 0;
+    }
+
+    // `read` gets at the source to print errors (see `diag::print`)
+    template <typename Read>
+    bool run(TokenStream& tokens, Options const& options, std::ostream& out, Read read) {
+        {
+            profile::Phase phase("parse"_s);
+            Parser p = Parser::create(tokens);
+            bool parsed = p.parse();
+            if(tokens.reader != nullptr && tokens.reader->error != 0) {
+                // whatever parsed was only the front of the source
+                out << "--ERROR could not read the source: " << std::strerror(tokens.reader->error) << std::endl;
+                return false;
+            }
+            if(!parsed) {
+                diag::print(out, p.diagnostics.full_slice(), read);
+                return false;
+            }
+
+            SCOPE_NODE->pop();
+        }
+
+        {
+            profile::Phase phase("sccp"_s);
+            sccp::Stats sccp_stats = sccp::run(START_NODE, STOP_NODE);
+            profile::note(sccp_stats);
+        }
+
+        {
+            profile::Phase phase("peepholes"_s);
+            peeps::Stats peeps_stats = peeps::run(START_NODE);
+            profile::note(peeps_stats);
+        }
+
+        {
+            profile::Phase phase("compact"_s);
+            compact::Stats compact_stats = compact::run(START_NODE, STOP_NODE, compact_arena);
+            profile::note(compact_stats);
+        }
+
+        if(options.dot_path != nullptr) {
+            profile::Phase phase("dot"_s);
+            Str dot = compile::dot(START_NODE);
+            std::ofstream outfile(options.dot_path);
+            outfile << dot;
+        }
+
+        if(options.program_input != nullptr) {
+            profile::Phase phase("evaluate"_s);
+            u64 output_value = Evaluator::create_and_run(START_NODE, atoi(options.program_input), 100000);
+            out << "Program output: " << output_value << std::endl;
+        }
+
+        {
+            profile::Phase phase("idom"_s);
+            node::compute_idom();
+        }
+        {
+            profile::Phase phase("gcm"_s);
+            gcm::build((NodeStart*) START_NODE, (NodeStop*) STOP_NODE);
+        }
+        {
+            profile::Phase phase("dump"_s);
+            out << compile::dump(START_NODE);
+        }
+        return true;
+    }
+};
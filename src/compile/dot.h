@@ -92,7 +92,7 @@ namespace compile {
                 NodePhi* node = (NodePhi*) n;
                 Str uid = str::from_int(n->uid);
                 output.push_slice(str::cat(
-                    uid, " [label=\"phi_"_s, node->debug_var_name, "\"];\n"_s
+                    uid, " [label=\"phi_"_s, sym::name(node->debug_var), "\"];\n"_s
                 ));
                 break;
             }
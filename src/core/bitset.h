@@ -4,45 +4,56 @@
 #include "mem.h"
 
 // any methods that accept size/capacity, will accept number of bits, not bytes or words
+// bulk operations are plain loops over 64 bit words, so the compiler vectorizes them (SSE2, or AVX2 with -mavx2)
 struct BitSet {
-    typedef u8 bits;
+    typedef u64 bits;
     bits* data; // nullable, owned
     usize size; // real size of the array (not in bits)
 
     mem::Arena* arena;
 
+    static constexpr usize WORD_BITS = sizeof(bits) * 8;
+    static constexpr usize NONE = U64_MAX; // returned by `find_next_set` when there are no more set bits
+
     static BitSet create(mem::Arena& arena = default_arena) {
         BitSet s {};
         s.arena = &arena;
         return s;
     }
 
+    // room for `capacity` bits up front (e.g. `Node::uid_counter + 1`), so `set` never has to grow
+    static BitSet create(usize capacity, mem::Arena& arena = default_arena) {
+        BitSet s = BitSet::create(arena);
+        s.reserve_bits(capacity);
+        return s;
+    }
+
     // size = in sizeof(bits), not bits
     void reserve(usize new_size) {
         if(arena == nullptr) arena = &default_arena;
         data = arena->realloc(data, size, new_size);
-        mem::zero(data+size, new_size-size); // zero out the new bytes
+        mem::zero(data+size, new_size-size); // zero out the new words
         size = new_size;
     }
 
     // num = number of bits to reserve for
     void reserve_bits(usize num) {
-        usize i = ceil_div(num,(sizeof(bits)*8));
-        if(i >= size) { this->reserve(i); }
+        usize i = ceil_div(num, WORD_BITS);
+        if(i > size) { this->reserve(i); }
     }
 
     void set(usize num) {
-        usize i = num/(sizeof(bits)*8);
-        usize offset = num%(sizeof(bits)*8);
+        usize i = num/WORD_BITS;
+        usize offset = num%WORD_BITS;
         if(i >= size) { this->reserve(next_power_of_two(i+1)); }
         data[i] |= (bits(1) << offset);
     }
 
     void unset(usize num) {
-        usize i = num/(sizeof(bits)*8);
-        usize offset = num%(sizeof(bits)*8);
+        usize i = num/WORD_BITS;
+        usize offset = num%WORD_BITS;
         if(i >= size) { return; }
-        data[i] &= bits(~(bits(1) << offset));
+        data[i] &= ~(bits(1) << offset);
     }
 
     void toggle(usize num) {
@@ -53,8 +64,8 @@ struct BitSet {
     /* Access Member Functions */
 
     bool operator[](usize i) const {
-        usize bits_i = i/(sizeof(bits)*8);
-        usize bits_offset = i%(sizeof(bits)*8);
+        usize bits_i = i/WORD_BITS;
+        usize bits_offset = i%WORD_BITS;
         if(bits_i >= size) { return false; }
         return (data[bits_i] >> bits_offset) & 1;
     }
@@ -67,6 +78,56 @@ struct BitSet {
         mem::zero(data, size);
     }
 
+    // number of set bits
+    usize popcount() const {
+        usize count = 0;
+        for(usize i = 0; i < size; i++) count += std::popcount(data[i]);
+        return count;
+    }
+
+    bool empty() const {
+        for(usize i = 0; i < size; i++) {
+            if(data[i] != 0) return false;
+        }
+        return true;
+    }
+
+    // index of the first set bit at or after `from`; `NONE` if there's none
+    usize find_next_set(usize from) const {
+        usize i = from/WORD_BITS;
+        if(i >= size) return NONE;
+        bits word = data[i] & (~bits(0) << (from%WORD_BITS));
+        while(word == 0) {
+            if(++i == size) return NONE;
+            word = data[i];
+        }
+        return i*WORD_BITS + std::countr_zero(word);
+    }
+
+    /* Set operations */
+
+    // union
+    BitSet& operator|=(BitSet const& other) {
+        if(other.size > size) this->reserve(other.size);
+        for(usize i = 0; i < other.size; i++) data[i] |= other.data[i];
+        return *this;
+    }
+
+    // intersection
+    BitSet& operator&=(BitSet const& other) {
+        usize common = min(size, other.size);
+        for(usize i = 0; i < common; i++) data[i] &= other.data[i];
+        for(usize i = common; i < size; i++) data[i] = 0;
+        return *this;
+    }
+
+    // difference
+    BitSet& operator-=(BitSet const& other) {
+        usize common = min(size, other.size);
+        for(usize i = 0; i < common; i++) data[i] &= ~other.data[i];
+        return *this;
+    }
+
     /* Cloning */
 
     // if `new_arena` is `nullptr`, use the same arena as `this`
@@ -81,13 +142,31 @@ struct BitSet {
         mem::copy<bits>(newbs.data, data, size);
         return newbs;
     }
+
+    /* STL Compatibility */
+
+    // iterates over the indices of the set bits
+    struct Iterator {
+        BitSet const* set;
+        usize i;
+
+        usize operator*() const { return i; }
+        Iterator& operator++() { i = set->find_next_set(i+1); return *this; }
+        bool operator!=(Iterator const& other) const { return i != other.i; }
+    };
+
+    Iterator begin() const { return Iterator { .set = this, .i = this->find_next_set(0) }; }
+    Iterator end() const { return Iterator { .set = this, .i = NONE }; }
 };
 
 std::ostream& operator<<(std::ostream& os, BitSet const& bitset) {
-    os << '[';
-    for(usize i = 0; i < bitset.size * sizeof(BitSet::bits) * 8; i++) {
-        os.put(bitset[i] ? '1' : '0');
+    os << '{';
+    bool first = true;
+    for(usize i : bitset) {
+        if(!first) os << ", ";
+        os << i;
+        first = false;
     }
-    os << ']';
+    os << '}';
     return os;
-}
\ No newline at end of file
+}
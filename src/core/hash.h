@@ -2,30 +2,98 @@
 
 #include "prelude.h"
 
-// #define hash_int(type) u64 from(type int_t) { return (u64) int_t; }
-
 // Does not support unions
+// every `hash::from` is expected to return a well mixed hash; tables use the bits directly (see `swiss.h`)
 namespace hash {
+    // wyhash constants
+    constexpr u64 P0 = 0xa0761d6478bd642full;
+    constexpr u64 P1 = 0xe7037ed1a0b428dbull;
+    constexpr u64 P2 = 0x8ebc6af09c88c6e3ull;
+    constexpr u64 P3 = 0x589965cc75374cc3ull;
+
+    // 64x64->128 bit multiply, folded back into 64 bits
+    u64 mum(u64 a, u64 b) {
+        __uint128_t r = (__uint128_t) a * b;
+        return (u64) r ^ (u64) (r >> 64);
+    }
+
+    // murmur3 finalizer; a bijection, so distinct ints never collide before being reduced to a table index
+    u64 mix(u64 x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // order dependent: combine(a, b) != combine(b, a)
+    u64 combine(u64 seed, u64 h) {
+        return hash::mix(std::rotl(seed, 25) + h);
+    }
+    template <typename... Rest>
+    u64 combine(u64 seed, u64 h, Rest... rest) {
+        return hash::combine(hash::combine(seed, h), rest...);
+    }
+
+    u64 read8(u8 const* p) { u64 v; std::memcpy(&v, p, 8); return v; }
+    u64 read4(u8 const* p) { u32 v; std::memcpy(&v, p, 4); return v; }
+
+    // wyhash (final4) over raw bytes
+    u64 bytes(void const* data, usize len, u64 seed = 0) {
+        u8 const* p = (u8 const*) data;
+        seed ^= hash::mum(seed ^ P0, P1);
+        u64 a, b;
+        if(len <= 16) {
+            if(len >= 4) {
+                usize mid = (len >> 3) << 2;
+                a = (hash::read4(p) << 32) | hash::read4(p + mid);
+                b = (hash::read4(p + len - 4) << 32) | hash::read4(p + len - 4 - mid);
+            } else if(len > 0) {
+                a = ((u64) p[0] << 16) | ((u64) p[len >> 1] << 8) | p[len - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            usize i = len;
+            if(i > 48) {
+                u64 s1 = seed, s2 = seed;
+                do {
+                    seed = hash::mum(hash::read8(p) ^ P1, hash::read8(p + 8) ^ seed);
+                    s1 = hash::mum(hash::read8(p + 16) ^ P2, hash::read8(p + 24) ^ s1);
+                    s2 = hash::mum(hash::read8(p + 32) ^ P3, hash::read8(p + 40) ^ s2);
+                    p += 48; i -= 48;
+                } while(i > 48);
+                seed ^= s1 ^ s2;
+            }
+            while(i > 16) {
+                seed = hash::mum(hash::read8(p) ^ P1, hash::read8(p + 8) ^ seed);
+                p += 16; i -= 16;
+            }
+            a = hash::read8(p + i - 16);
+            b = hash::read8(p + i - 8);
+        }
+        __uint128_t r = (__uint128_t) (a ^ P1) * (b ^ seed);
+        return hash::mum((u64) r ^ P0 ^ len, (u64) (r >> 64) ^ P1);
+    }
+
     template <std::integral T>
     u64 from(T i) {
-        return (u64) i;
+        return hash::mix((u64) i);
     }
 
-    // template <std::floating_point T>
-    // u64 from(T i) {
-    //     return (u64) std::bit_cast(i);
-    // }
-
+    // -0.0 == 0.0, so they must hash the same
     u64 from(f32 f) {
-        return (u64) std::bit_cast<f32>(f);
+        if(f == 0) f = 0;
+        return hash::mix(std::bit_cast<u32>(f));
     }
 
     u64 from(f64 f) {
-        return (u64) std::bit_cast<f64>(f);
+        if(f == 0) f = 0;
+        return hash::mix(std::bit_cast<u64>(f));
     }
 
-    // hash_int(u8); hash_int(i8); hash_int(u16); hash_int(i16); hash_int(u32); hash_int(i32); hash_int(u64); hash_int(i64); hash_int(usize); // apparently same as u64 on my machine...
-
     template <typename T>
     concept EnumClassConcept = std::is_enum_v<T> && !std::is_convertible_v<T, std::underlying_type_t<T>>; // I have no idea either
 
@@ -39,12 +107,11 @@ namespace hash {
 
     template <PointerConcept T>
     u64 from(T s) {
-        // return s->hash();
-        return (u64)(s); // simply cast the pointer to an int
+        return hash::mix((u64) s); // hash the address; arena pointers share most of their bits
     }
 
     template <typename T>
     u64 from(T s) {
         return s.hash();
     }
-}
\ No newline at end of file
+}
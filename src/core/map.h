@@ -6,33 +6,23 @@
 #include "pair.h"
 #include "vec.h"
 #include "hash.h"
+#include "swiss.h"
 
-#define MAX_HIT_COUNT 0b01111111
-
-// Hash Map (a bad implementation of one, at least)
+// Hash Map
+// open addressing with SwissTable style control bytes; see `swiss.h`
 // keys must have == operator defined
 template <typename K, typename V>
 struct HMap {
     struct Entry {
-        u8 flags; // 0bccccccce where e=exists flag, c=hit count bits (7 total)
-        // u64 key_hash; // calculating the hash is expensive
         K key;
         V value;
-
-        bool exists() const { return flags & 1; }
-        u8 hit_count() const { return flags >> 1; }
-        void increment_hit_count() { assert(this->hit_count() < (MAX_HIT_COUNT)); flags += 2; }
-        void decrement_hit_count() { assert(this->hit_count() > 0); flags -= 2; }
-        void replace_with(K key, V val) { this->flags |= 1; this->key = key; this->value = val; }
-        void destroy() { this->flags &= ~(1); }
     };
 
-    Vec<Entry> map;
-    u32 size;
-    u32 capacity;
-
-    static constexpr usize c1 = 0;
-    static constexpr usize c2 = 1;
+    Entry* entries; // nullable, owned; `capacity` long
+    u8* ctrl; // nullable, owned; `capacity` long
+    u32 size; // number of full slots
+    u32 used; // number of full slots + tombstones
+    u32 capacity; // power of two (or 0)
 
     mem::Arena* arena;
 
@@ -50,92 +40,85 @@ struct HMap {
         return (f32) size / (f32) capacity;
     }
 
+    u32 find(K const& key) const {
+        return swiss::find(ctrl, capacity, hash::from(key), [&](u32 i) { return entries[i].key == key; });
+    }
+
     void add(K key, V val) {
-        size++;
-        if(this->load_factor() > 0.75) {
-            this->resize();
-        }
-        size--;
         u64 hash = hash::from(key);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; map[index].exists() && !(map[index].key == key); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
+        u32 index = swiss::find(ctrl, capacity, hash, [&](u32 i) { return entries[i].key == key; });
+        if(index != swiss::NONE) {
+            entries[index].value = val;
+            return;
         }
-        if(!(map[index].exists())) {
-            size++;
-            if(init_index != index) { map[init_index].increment_hit_count(); }
-        }
-        map[index].replace_with(key, val);
+        if(used + 1 > swiss::max_used(capacity)) this->resize();
+        index = swiss::find_free(ctrl, capacity, hash);
+        if(ctrl[index] == swiss::EMPTY) used++;
+        ctrl[index] = swiss::h2(hash);
+        entries[index] = Entry { .key = key, .value = val };
+        size++;
     }
 
+    // rebuild the table, dropping tombstones; only grows if it's at least half full
     void resize() {
-        Vec<Entry> old_map = map;
-        this->map = Vec<Entry>::create(*arena); // create a new vec; it'd be difficult to rehash in-place
-        this->capacity = next_prime_size(capacity);
-        this->map.reserve(capacity);
-        this->map.size = map.capacity;
-        // copy all elements from the old map
-        for(Entry& e : old_map) {
-            // theoretically preserving element order may be beneficial? buuut
-            if(e.exists())
-                this->add(e.key, e.value);
+        if(arena == nullptr) arena = &default_arena;
+        Entry* old_entries = entries;
+        u8* old_ctrl = ctrl;
+        u32 old_capacity = capacity;
+        if(capacity == 0) capacity = swiss::GROUP;
+        else if(size + 1 > capacity / 2) capacity *= 2;
+        entries = arena->alloc<Entry>(capacity);
+        ctrl = swiss::alloc_ctrl(*arena, capacity);
+        size = 0; used = 0;
+        for(u32 i = 0; i < old_capacity; i++) {
+            if(old_ctrl[i] & 0x80) continue; // EMPTY or DELETED
+            u64 hash = hash::from(old_entries[i].key);
+            u32 index = swiss::find_free(ctrl, capacity, hash);
+            ctrl[index] = swiss::h2(hash);
+            entries[index] = old_entries[i];
+            size++; used++;
         }
     }
 
+    // return true if the key was there
+    bool remove(K key) {
+        u32 index = this->find(key);
+        if(index == swiss::NONE) return false;
+        u8 erased = swiss::erased(ctrl, index);
+        if(erased == swiss::EMPTY) used--;
+        ctrl[index] = erased;
+        size--;
+        return true;
+    }
+
     void clear() {
-        for(Entry& e : map) {
-            e.flags = 0; // full reset
-        }
+        if(ctrl != nullptr) std::memset(ctrl, swiss::EMPTY, capacity);
+        size = 0; used = 0;
     }
 
     /* Access Member Functions */
 
     V const& operator[](K key) const {
-        assert(capacity > 0);
-        u64 hash = hash::from(key);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; map[index].exists() && !(map[index].key == key); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        assert(map[index].exists());
-        return map[index].value;
+        u32 index = this->find(key);
+        assert(index != swiss::NONE);
+        return entries[index].value;
     }
 
     V& operator[](K key) {
-        assert(capacity > 0);
-        u64 hash = hash::from(key);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; map[index].exists() && !(map[index].key == key); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        assert(map[index].exists());
-        return map[index].value;
+        u32 index = this->find(key);
+        assert(index != swiss::NONE);
+        return entries[index].value;
     }
 
     bool exists(K key) const {
-        if(capacity == 0) return false;
-        u64 hash = hash::from(key);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; map[index].exists() && !(map[index].key == key); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        return map[index].exists();
+        return this->find(key) != swiss::NONE;
     }
 
     // linear lookup time
     Maybe<K> key_of(V val) const {
-        for(u32 i = 0; i < map.size; i++) {
-            Entry const& e = map[i];
-            if(e.exists() && e.value == val) {
-                return { .val = e.key, .here = true };
+        for(u32 i = 0; i < capacity; i++) {
+            if(!(ctrl[i] & 0x80) && entries[i].value == val) {
+                return { .val = entries[i].key, .here = true };
             }
         }
         return { .here = false };
@@ -146,10 +129,13 @@ struct HMap {
     // if `new_arena` is `nullptr`, use the same arena as `this`
     HMap<K, V> clone(mem::Arena* new_arena = nullptr) {
         if(new_arena == nullptr) new_arena = arena;
-        HMap<K, V> cloned {};
-        cloned.size = size;
-        cloned.capacity = capacity;
-        cloned.map = map.clone(new_arena);
+        HMap<K, V> cloned = *this;
+        cloned.arena = new_arena;
+        if(capacity == 0) return cloned;
+        cloned.entries = new_arena->alloc<Entry>(capacity);
+        cloned.ctrl = new_arena->alloc<u8>(capacity);
+        mem::copy(cloned.entries, entries, capacity);
+        mem::copy(cloned.ctrl, ctrl, capacity);
         return cloned;
     }
-};
\ No newline at end of file
+};
@@ -2,6 +2,15 @@
 
 #include "prelude.h"
 
+// arena blocks that have been given back are poisoned under AddressSanitizer, so a stale pointer into a reallocated
+// buffer gets caught instead of silently reading recycled memory
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#else
+#define ASAN_POISON_MEMORY_REGION(addr, size) ((void) (addr), (void) (size))
+#define ASAN_UNPOISON_MEMORY_REGION(addr, size) ((void) (addr), (void) (size))
+#endif
+
 namespace mem {
     template <typename T>
     T* alloc(usize size) {
@@ -43,22 +52,141 @@ namespace mem {
     }
 
     // Arena handles must be stored on a stack OR freed manually
+    // A fixed arena (`Arena::create`) is a single block and exits once it's full
+    // A chunked arena (`Arena::create_chunked`) chains a new, bigger block whenever the current one fills up
     struct Arena {
-        u8* data;
+        // header at the start of every block
+        struct Chunk {
+            Chunk* prev; // nullable; the previous (older) chunk
+            usize size; // in bytes, including this header
+            usize prev_used; // bytes used in all of the older chunks
+        };
+
+        // a position in the arena to `rewind` to
+        struct Mark {
+            Chunk* chunk;
+            u8* cur;
+        };
+
+        // a block given back with `release`; it's linked into the free list of its size class
+        struct FreeBlock {
+            FreeBlock* next; // nullable
+        };
+
+        static constexpr usize max_chunk_size = 64 MB; // chunks stop doubling in size after this
+        static constexpr u32 min_free_class = 4; // smallest recycled block is 16 bytes
+        static constexpr u32 free_classes = 16; // size class `c` holds blocks of at least `1 << (c + min_free_class)` bytes
+
+        Chunk* chunk; // newest chunk
+        u8* data; // start of the newest chunk's memory
         u8* cur;
         u8* end_ptr;
+        bool chunked;
+        usize high_water; // see `high_water_mark`
+        FreeBlock* free_lists[free_classes]; // nullable; see `release` and `recycle`
+
+        Arena(Chunk* c, bool chunked) : chunk(c), data((u8*) (c + 1)), cur((u8*) (c + 1)), end_ptr((u8*) c + c->size),
+                                        chunked(chunked), high_water(0), free_lists{} {}
+        // the chunks belong to one arena only; a copy would free them a second time
+        Arena(Arena const&) = delete;
+        Arena& operator=(Arena const&) = delete;
+        // the moved-from arena has no chunks left, and must not be allocated from
+        Arena(Arena&& other) : chunk(other.chunk), data(other.data), cur(other.cur), end_ptr(other.end_ptr),
+                               chunked(other.chunked), high_water(other.high_water) {
+            mem::copy(free_lists, other.free_lists, free_classes);
+            other.chunk = nullptr;
+        }
 
         ~Arena() {
-            mem::free(data);
+            while(chunk != nullptr) {
+                Chunk* prev = chunk->prev;
+                mem::free(chunk);
+                chunk = prev;
+            }
         }
-        
+
+        static Arena create(usize size) {
+            return Arena(Arena::new_chunk(size + sizeof(Chunk)), false);
+        }
+
+        // `chunk_size` is the size of the first block; the following ones double in size
+        static Arena create_chunked(usize chunk_size = 64 KB) {
+            return Arena(Arena::new_chunk(chunk_size + sizeof(Chunk)), true);
+        }
+
+        static Chunk* new_chunk(usize size) {
+            Chunk* c = (Chunk*) mem::alloc<u8>(size);
+            if(c == nullptr) {
+                std::cout << "Fatal: Could not allocate memory" << std::endl;
+                exit(1);
+            }
+            *c = Chunk { .prev = nullptr, .size = size, .prev_used = 0 };
+            return c;
+        }
+
+        // number of bytes handed out (including alignment padding and the tails of the older chunks)
+        usize used() const {
+            return chunk->prev_used + (cur - data);
+        }
+
+        // the most bytes that were ever in use at once
+        usize high_water_mark() const {
+            return max(high_water, this->used());
+        }
+
+        Mark mark() const {
+            return Mark { .chunk = chunk, .cur = cur };
+        }
+
+        // free everything allocated after `m` was taken
+        void rewind(Mark m) {
+            high_water = this->high_water_mark();
+            while(chunk != m.chunk) {
+                assert(chunk != nullptr); // `m` is not from this arena
+                Chunk* prev = chunk->prev;
+                mem::free(chunk);
+                chunk = prev;
+            }
+            data = (u8*) (chunk + 1);
+            end_ptr = (u8*) chunk + chunk->size;
+            cur = m.cur;
+            // some of the recycled blocks may have been after `m`; forget all of them
+            for(u32 c = 0; c < free_classes; c++) free_lists[c] = nullptr;
+            ASAN_UNPOISON_MEMORY_REGION(cur, end_ptr - cur);
+        }
+
+        // free everything; keeps only the first chunk
         void reset() {
+            Chunk* first = chunk;
+            while(first->prev != nullptr) first = first->prev;
+            this->rewind(Mark { .chunk = first, .cur = (u8*) (first + 1) });
+        }
+
+        void push_chunk(usize size) {
+            Chunk* c = Arena::new_chunk(size);
+            high_water = this->high_water_mark();
+            c->prev = chunk;
+            c->prev_used = this->used();
+            chunk = c;
+            data = (u8*) (c + 1);
             cur = data;
+            end_ptr = (u8*) c + size;
         }
 
-        static Arena create(usize size) {
-            u8* ptr = mem::alloc<u8>(size);
-            return Arena { .data = ptr, .cur = ptr, .end_ptr = ptr+size };
+        // slow path of `alloc`; the current chunk doesn't have `bytes` left
+        void* grow(usize bytes, usize align) {
+            if(!chunked) {
+                std::cout << "Fatal: Could not allocate memory" << std::endl;
+                exit(1);
+            }
+            usize size = min(chunk->size * 2, max_chunk_size);
+            size = max(size, bytes + align + sizeof(Chunk));
+            this->push_chunk(size);
+            void* ptr = cur;
+            usize size_left = end_ptr-cur;
+            ptr = std::align(align, bytes, ptr, size_left);
+            assert(ptr != nullptr);
+            return ptr;
         }
 
         // does **not** zero initialize
@@ -67,8 +195,7 @@ namespace mem {
             void* ptr = cur;
             usize size_left = end_ptr-cur;
             if (std::align(alignof(T), sizeof(T) * size, ptr, size_left) == nullptr) {
-                std::cout << "Fatal: Could not allocate memory" << std::endl;
-                exit(1);
+                ptr = this->grow(sizeof(T) * size, alignof(T));
             }
             cur = (u8*) ptr + sizeof(T) * size;
             return (T*) ptr;
@@ -94,19 +221,47 @@ namespace mem {
                 return ptr;
             }
             // printf("----cur=%p, ptr=%p, sizeof(T)=%ld, last_size=%ld, expr=%p \n", cur, ptr, sizeof(T), last_size, ((u8*) ptr + sizeof(T)*last_size));
-            if(((u8*) ptr + sizeof(T)*last_size) == cur) {
+            if(((u8*) ptr + sizeof(T)*last_size) == cur && (usize) (end_ptr - cur) >= (new_size - last_size) * sizeof(T)) {
                 // printf("----extanding pointer at %p from %ld to %ld\n", ptr, last_size, new_size);
-                // no new allocations were made
+                // no new allocations were made and there's space left in this chunk
                 cur += (new_size - last_size) * sizeof(T);
                 return ptr;
             }
-            // reallocate and copy memory
-            T* out = this->alloc<T>(new_size);
-            mem::copy(out, ptr, last_size);
+            // reallocate and copy memory; the old block can be reused by the next reallocation that fits in it
+            T* out = (T*) this->recycle(sizeof(T) * new_size, alignof(T));
+            if(out == nullptr) out = this->alloc<T>(new_size);
+            if(last_size > 0) mem::copy(out, ptr, last_size);
+            this->release(ptr, sizeof(T) * last_size);
             // printf("----reallocating and copying at %p (size=%ld) to %p (size=%ld)\n", ptr, last_size, out, new_size);
             return out;
         }
 
+        // give back a block of `bytes` bytes that nothing points to anymore (a buffer that got reallocated)
+        // it goes into the free list of the biggest size class that it fits, so blocks of any size can be recycled
+        void release(void* ptr, usize bytes) {
+            if(ptr == nullptr || bytes < (1 << min_free_class) || (usize) ptr % alignof(FreeBlock) != 0) return;
+            u32 c = min((u32) std::bit_width(bytes) - 1 - min_free_class, free_classes - 1);
+            FreeBlock* block = (FreeBlock*) ptr;
+            block->next = free_lists[c];
+            free_lists[c] = block;
+            ASAN_POISON_MEMORY_REGION(ptr, bytes);
+        }
+
+        // a released block of at least `bytes` bytes; nullptr if there is none
+        // only looks at the size class that's guaranteed to fit, so this is O(1)
+        void* recycle(usize bytes, usize align) {
+            if(align > alignof(FreeBlock)) return nullptr;
+            bytes = max(bytes, (usize) 1 << min_free_class);
+            u32 c = (u32) std::bit_width(bytes - 1) - min_free_class;
+            if(c >= free_classes) return nullptr;
+            FreeBlock* block = free_lists[c];
+            if(block == nullptr) return nullptr;
+            ASAN_UNPOISON_MEMORY_REGION(block, sizeof(FreeBlock));
+            free_lists[c] = block->next;
+            ASAN_UNPOISON_MEMORY_REGION(block, bytes);
+            return block;
+        }
+
         template <typename T>
         T* clone(T* ptr, usize size) {
             T* cloned = this->alloc<T>(size);
@@ -115,6 +270,58 @@ namespace mem {
             return cloned;
         }
     };
+
+    // Reusable scratch arenas, one for each nesting level of `mem::Scratch`; kept around for the whole thread
+    // Each level gets its own arena, so a container from an outer level can keep growing while an inner level is checked out
+    struct ScratchPool {
+        static constexpr usize first_chunk_size = 256 KB;
+
+        Arena** arenas; // nullable, owned; `arenas[i]` is created the first time level `i` is reached
+        u32 capacity;
+        u32 depth; // number of levels currently checked out
+
+        ~ScratchPool() {
+            for(u32 i = 0; i < capacity; i++) delete arenas[i];
+            mem::free(arenas);
+        }
+
+        Arena* push() {
+            if(depth == capacity) {
+                u32 new_capacity = capacity == 0 ? 8 : capacity * 2;
+                arenas = mem::realloc(arenas, new_capacity);
+                for(u32 i = capacity; i < new_capacity; i++) arenas[i] = nullptr;
+                capacity = new_capacity;
+            }
+            if(arenas[depth] == nullptr) arenas[depth] = new Arena(Arena::create_chunked(first_chunk_size));
+            return arenas[depth++];
+        }
+
+        void pop() {
+            assert(depth > 0);
+            depth--;
+        }
+    };
+
+    thread_local ScratchPool scratch_pool {};
+
+    // Check out a scratch arena for the current scope; everything allocated in it is freed when this goes out of scope
+    // Nothing allocated in `*scratch.arena` may outlive `scratch`
+    // `mem::Scratch scratch; Vec<T> v = Vec<T>::create(*scratch.arena);`
+    struct Scratch {
+        Arena* arena;
+        Arena::Mark mark;
+
+        Scratch() {
+            arena = scratch_pool.push();
+            mark = arena->mark();
+        }
+        ~Scratch() {
+            arena->rewind(mark);
+            scratch_pool.pop();
+        }
+        Scratch(Scratch const&) = delete;
+        Scratch& operator=(Scratch const&) = delete;
+    };
 };
 
-mem::Arena default_arena = mem::Arena::create(64 MB);
\ No newline at end of file
+thread_local mem::Arena default_arena = mem::Arena::create_chunked(1 MB); // each thread gets its own
\ No newline at end of file
@@ -72,8 +72,9 @@ T min(T a, T b) { return a < b ? a : b; }
 
 usize next_power_of_two(usize n) {
     assert(sizeof(usize) == sizeof(unsigned long long));
+    if(n <= 1) return 1; // `__builtin_clzll(0)` is undefined
     i32 leading_zeros = __builtin_clzll(n);
-    usize closest_pow_2 = 1 << (sizeof(usize)*8 - leading_zeros - 1);
+    usize closest_pow_2 = (usize) 1 << (sizeof(usize)*8 - leading_zeros - 1);
     if(n != closest_pow_2) closest_pow_2 <<= 1;
     return closest_pow_2;
 }
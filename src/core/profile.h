@@ -0,0 +1,229 @@
+#pragma once
+
+#include "prelude.h"
+#include "mem.h"
+#include "str.h"
+#include "vec.h"
+#include "map.h"
+
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Compilation phase profiler
+// Does nothing unless `profile::enable` has been called (`--time-report`). Wrap a phase in a `profile::Phase` scope;
+// phases can nest. For every phase it records the wall time, the cycle count (rdtsc on x86), how many bytes the tracked
+// arenas grew by and the values of the tracked counters when it ended. `profile::rule` counts how often each peephole
+// rule fires, and `profile::note` keeps a pass's own stats with the phase it ran in. `report` prints it all as a table and `trace` writes it in Chrome's trace event format (chrome://tracing
+// or https://ui.perfetto.dev).
+namespace profile {
+    static constexpr u32 MAX_COUNTERS = 4;
+
+    // a number worth knowing at the end of every phase (e.g. number of nodes)
+    struct Counter {
+        Str name;
+        u64 (*read)();
+    };
+
+    struct Record {
+        Str name;
+        u32 depth; // number of phases this one is nested in
+        u64 start_ns; // since `enable`
+        u64 ns;
+        u64 cycles;
+        i64 bytes; // growth of the tracked arenas; negative if they were reset
+        u64 counters[MAX_COUNTERS];
+    };
+
+    struct Rule {
+        Str name;
+        u64 hits;
+    };
+
+    struct Note {
+        u32 record; // the phase it was made in
+        Str text;
+    };
+
+    struct Profiler {
+        bool enabled;
+        u32 depth;
+        u32 current; // index of the innermost running phase; `U32_MAX` if there's none
+        std::chrono::steady_clock::time_point origin;
+        Vec<Record> records; // in the order the phases started
+        Vec<mem::Arena*> arenas;
+        Vec<Counter> counters;
+        Vec<Rule> rules;
+        HMap<Str,u32> rule_index; // name -> index into `rules`
+        Vec<Note> notes;
+    };
+
+    // per thread, like the rest of the compiler's state; only the thread that called `enable` is profiled
+    thread_local mem::Arena arena = mem::Arena::create_chunked(16 KB); // the profiler's own; it's not tracked
+    thread_local Profiler state {};
+
+    void enable() {
+        state = Profiler {
+            .enabled = true,
+            .current = U32_MAX,
+            .origin = std::chrono::steady_clock::now(),
+            .records = Vec<Record>::create(profile::arena),
+            .arenas = Vec<mem::Arena*>::create(profile::arena),
+            .counters = Vec<Counter>::create(profile::arena),
+            .rules = Vec<Rule>::create(profile::arena),
+            .rule_index = HMap<Str,u32>::create(&profile::arena),
+            .notes = Vec<Note>::create(profile::arena),
+        };
+    }
+
+    bool enabled() {
+        return state.enabled;
+    }
+
+    // count the bytes used by `a` towards every phase
+    void track(mem::Arena& a) {
+        if(!state.enabled) return;
+        state.arenas.push(&a);
+    }
+
+    void track(Str name, u64 (*read)()) {
+        if(!state.enabled) return;
+        assert(state.counters.size < MAX_COUNTERS);
+        state.counters.push(Counter { .name = name, .read = read });
+    }
+
+    u64 now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state.origin).count();
+    }
+
+    u64 cycles() {
+        #if defined(__x86_64__)
+        return __rdtsc();
+        #else
+        return 0;
+        #endif
+    }
+
+    usize arena_bytes() {
+        usize bytes = 0;
+        for(mem::Arena* a : state.arenas) bytes += a->used();
+        return bytes;
+    }
+
+    // `profile::Phase p("parse"_s);` times everything until the end of the scope
+    struct Phase {
+        u32 index; // into `state.records`; `U32_MAX` if the profiler is off
+        u32 parent; // `state.current` before this one started
+        u64 start_cycles;
+        usize start_bytes;
+
+        Phase(Str name) {
+            index = U32_MAX;
+            if(!state.enabled) return;
+            index = state.records.size;
+            state.records.push(Record { .name = name, .depth = state.depth, .start_ns = profile::now_ns() });
+            state.depth++;
+            parent = state.current;
+            state.current = index;
+            start_bytes = profile::arena_bytes();
+            start_cycles = profile::cycles();
+        }
+        ~Phase() {
+            if(index == U32_MAX) return;
+            u64 end_cycles = profile::cycles();
+            Record& r = state.records[index];
+            r.ns = profile::now_ns() - r.start_ns;
+            r.cycles = end_cycles - start_cycles;
+            r.bytes = (i64) profile::arena_bytes() - (i64) start_bytes;
+            for(u32 i = 0; i < state.counters.size; i++) r.counters[i] = state.counters[i].read();
+            state.depth--;
+            state.current = parent;
+        }
+        Phase(Phase const&) = delete;
+        Phase& operator=(Phase const&) = delete;
+    };
+
+    void hit(Str name) {
+        u32 i = state.rule_index.find(name);
+        if(i == swiss::NONE) {
+            state.rule_index.add(name, state.rules.size);
+            state.rules.push(Rule { .name = name, .hits = 1 });
+            return;
+        }
+        state.rules[state.rule_index.entries[i].value].hits++;
+    }
+
+    // `return profile::rule("x+0 -> x"_s, lhs);` counts the rule when the profiler is on and returns `result`
+    template <typename T>
+    T rule(Str name, T result) {
+        if(state.enabled) profile::hit(name);
+        return result;
+    }
+
+    // keep `value` (anything that can be written to a stream) with the innermost running phase; `report` prints it
+    template <typename T>
+    void note(T const& value) {
+        if(!state.enabled) return;
+        std::ostringstream text;
+        text << value;
+        std::string const& cpp = text.str();
+        state.notes.push(Note { .record = state.current, .text = str::clone_cstr(cpp.data(), cpp.size(), profile::arena) });
+    }
+
+    void report(std::ostream& os) {
+        if(!state.enabled) return;
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-28s %10s %10s %10s", "phase", "ms", "Mcycles", "arena KB");
+        os << line;
+        for(Counter& c : state.counters) {
+            std::snprintf(line, sizeof(line), " %10.*s", (int) c.name.size, (char const*) c.name.data);
+            os << line;
+        }
+        os << "\n";
+        for(Record& r : state.records) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "%*s%.*s", r.depth * 2, "", (int) r.name.size, (char const*) r.name.data);
+            std::snprintf(line, sizeof(line), "%-28s %10.3f %10.3f %10.1f", name, r.ns / 1e6, r.cycles / 1e6, r.bytes / 1024.0);
+            os << line;
+            for(u32 i = 0; i < state.counters.size; i++) {
+                std::snprintf(line, sizeof(line), " %10lu", (unsigned long) r.counters[i]);
+                os << line;
+            }
+            os << "\n";
+        }
+        if(!state.notes.empty()) {
+            os << "pass stats:\n";
+            for(Note& n : state.notes) {
+                Str phase = n.record == U32_MAX ? "-"_s : state.records[n.record].name;
+                std::snprintf(line, sizeof(line), "  %-20.*s ", (int) phase.size, (char const*) phase.data);
+                os << line << n.text << "\n";
+            }
+        }
+        if(state.rules.empty()) return;
+        Vec<Rule> sorted = state.rules.clone();
+        std::sort(sorted.begin(), sorted.end(), [](Rule const& a, Rule const& b) { return a.hits > b.hits; });
+        os << "peephole rules:\n";
+        for(Rule& r : sorted) {
+            std::snprintf(line, sizeof(line), "  %-40.*s %10lu\n", (int) r.name.size, (char const*) r.name.data, (unsigned long) r.hits);
+            os << line;
+        }
+    }
+
+    // Chrome trace event JSON; every phase is a complete ("X") event, with the bytes and counters as its args
+    void trace(std::ostream& os) {
+        if(!state.enabled) return;
+        os << "{\"traceEvents\":[\n";
+        for(u32 i = 0; i < state.records.size; i++) {
+            Record& r = state.records[i];
+            os << "{\"name\":\"" << r.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+               << ",\"ts\":" << r.start_ns / 1000.0 << ",\"dur\":" << r.ns / 1000.0
+               << ",\"args\":{\"bytes\":" << r.bytes << ",\"cycles\":" << r.cycles;
+            for(u32 c = 0; c < state.counters.size; c++) os << ",\"" << state.counters[c].name << "\":" << r.counters[c];
+            os << "}}" << (i + 1 < state.records.size ? ",\n" : "\n");
+        }
+        os << "]}\n";
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "prelude.h"
+#include "mem.h"
+
+// Persistent vector (32-way trie)
+// `clone` is O(1): both copies keep pointing to the same nodes, and whichever one is modified first copies the path
+// from the root to the element it changes (path copying). Every node remembers which vector created it; a vector may
+// modify its own nodes in place, so a vector that's never cloned is about as cheap as a `Vec`.
+// T must be trivially copyable
+template <typename T>
+struct PVec {
+    static constexpr u32 BITS = 5;
+    static constexpr u32 WIDTH = 1 << BITS;
+    static constexpr u32 MASK = WIDTH - 1;
+
+    struct Node {
+        u32 owner; // the vector that created this node; only it may change the node in place
+        union {
+            Node* children[WIDTH]; // nullable
+            T values[WIDTH];
+        };
+    };
+
+    Node* root; // nullable
+    u32 size;
+    u32 shift; // BITS * (height of the trie - 1)
+    u32 owner;
+
+    mem::Arena* arena;
+
+    inline static thread_local u32 owner_counter = 0;
+
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    static PVec create(mem::Arena& arena = default_arena) {
+        PVec<T> v {};
+        v.arena = &arena;
+        v.owner = ++PVec<T>::owner_counter;
+        return v;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    // number of elements the trie can hold without getting taller
+    u64 capacity() const {
+        return root == nullptr ? 0 : (u64) WIDTH << shift;
+    }
+
+    Node* new_node() {
+        if(arena == nullptr) arena = &default_arena;
+        Node* n = arena->alloc<Node>(1);
+        mem::zero(n, 1);
+        n->owner = owner;
+        return n;
+    }
+
+    // return `n`, or a copy of it that `this` owns
+    Node* editable(Node* n) {
+        if(n == nullptr) return this->new_node();
+        if(n->owner == owner) return n;
+        Node* copy = this->new_node();
+        mem::copy(copy, n, 1);
+        copy->owner = owner;
+        return copy;
+    }
+
+    // the slot for element `i`; copies the path to it if it's shared
+    T& edit(u32 i) {
+        root = this->editable(root);
+        Node* n = root;
+        for(u32 level = shift; level > 0; level -= BITS) {
+            Node*& child = n->children[(i >> level) & MASK];
+            child = this->editable(child);
+            n = child;
+        }
+        return n->values[i & MASK];
+    }
+
+    void push(T const& e) {
+        if(size == this->capacity() && root != nullptr) {
+            // full; grow a level
+            Node* new_root = this->new_node();
+            new_root->children[0] = root;
+            root = new_root;
+            shift += BITS;
+        }
+        this->edit(size) = e;
+        size++;
+    }
+
+    T pop() {
+        assert(size > 0);
+        T e = (*this)[size-1];
+        size--;
+        return e;
+    }
+
+    void set(u32 i, T const& e) {
+        assert(i < size);
+        this->edit(i) = e;
+    }
+
+    /* Access Member Functions */
+
+    T const& operator[](u32 i) const {
+        assert(i < size);
+        Node* n = root;
+        for(u32 level = shift; level > 0; level -= BITS) {
+            n = n->children[(i >> level) & MASK];
+        }
+        return n->values[i & MASK];
+    }
+
+    T const& back() const {
+        assert(size > 0);
+        return (*this)[size-1];
+    }
+
+    /* Cloning */
+
+    // O(1); all nodes become shared, so neither copy can change them in place anymore
+    PVec<T> clone() {
+        PVec<T> cloned = *this;
+        cloned.owner = ++PVec<T>::owner_counter;
+        this->owner = ++PVec<T>::owner_counter;
+        return cloned;
+    }
+};
@@ -6,22 +6,18 @@
 #include "pair.h"
 #include "vec.h"
 #include "hash.h"
-#include "bitset.h"
+#include "swiss.h"
 
-#define MAX_HIT_COUNT 0b01111111
-
-// Hash Set (a bad implementation of one, at least)
+// Hash Set
+// open addressing with SwissTable style control bytes; see `swiss.h`
 // values must have == operator defined
 template <typename T>
 struct HSet {
-    T* set;
-    BitSet exists;
-    BitSet tombstone;
-    u32 size;
-    u32 capacity;
-
-    static constexpr usize c1 = 0;
-    static constexpr usize c2 = 1;
+    T* set; // nullable, owned; `capacity` long
+    u8* ctrl; // nullable, owned; `capacity` long
+    u32 size; // number of full slots
+    u32 used; // number of full slots + tombstones
+    u32 capacity; // power of two (or 0)
 
     mem::Arena* arena;
 
@@ -36,112 +32,81 @@ struct HSet {
     }
 
     f32 load_factor() {
-        return (f32) (size+1) / (f32) capacity;
+        return (f32) size / (f32) capacity;
+    }
+
+    u32 find(T const& val) const {
+        return swiss::find(ctrl, capacity, hash::from(val), [&](u32 i) { return set[i] == val; });
     }
 
+    // replaces the equal value if there's one already
     void add(T val) {
-        if(this->load_factor() > 0.75) {
-            this->resize();
-        }
         u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        if(!(exists[index])) {
-            size++;
-            tombstone.set(index);
-            exists.set(index);
+        u32 index = swiss::find(ctrl, capacity, hash, [&](u32 i) { return set[i] == val; });
+        if(index != swiss::NONE) {
+            set[index] = val;
+            return;
         }
+        if(used + 1 > swiss::max_used(capacity)) this->resize();
+        index = swiss::find_free(ctrl, capacity, hash);
+        if(ctrl[index] == swiss::EMPTY) used++;
+        ctrl[index] = swiss::h2(hash);
         set[index] = val;
+        size++;
     }
 
-    void remove(T& val) {
-        u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        u32 attempts = 1;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        if(!(exists[index])) { std::cout << "Element does not exist in the set" << std::endl; panic; } // cannot remove an element that doesn't exist
-        exists.unset(index);
+    void remove(T val) {
+        u32 index = this->find(val);
+        if(index == swiss::NONE) { std::cout << "Element does not exist in the set" << std::endl; panic; } // cannot remove an element that doesn't exist
+        u8 erased = swiss::erased(ctrl, index);
+        if(erased == swiss::EMPTY) used--;
+        ctrl[index] = erased;
+        size--;
     }
 
+    // rebuild the table, dropping tombstones; only grows if it's at least half full
     void resize() {
         if(arena == nullptr) { arena = &default_arena; }
-        mem::Arena scratch = mem::Arena::create(10 MB);
-        u32 old_capacity = capacity;
         T* old_set = set;
-        BitSet old_exists = exists.clone(&scratch);
-
-        capacity = next_prime_size(capacity);
+        u8* old_ctrl = ctrl;
+        u32 old_capacity = capacity;
+        if(capacity == 0) capacity = swiss::GROUP;
+        else if(size + 1 > capacity / 2) capacity *= 2;
         set = arena->alloc<T>(capacity);
-        tombstone.clear();
-        exists.clear();
-
-        // copy all elements from the old set
+        ctrl = swiss::alloc_ctrl(*arena, capacity);
+        size = 0; used = 0;
         for(u32 i = 0; i < old_capacity; i++) {
-            if(old_exists[i])
-                this->add(old_set[i]);
+            if(old_ctrl[i] & 0x80) continue; // EMPTY or DELETED
+            u64 hash = hash::from(old_set[i]);
+            u32 index = swiss::find_free(ctrl, capacity, hash);
+            ctrl[index] = swiss::h2(hash);
+            set[index] = old_set[i];
+            size++; used++;
         }
     }
 
     /* Access Member Functions */
 
     T const& operator[](T val) const {
-        assert(capacity > 0);
-        u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        assert(exists[index]);
+        u32 index = this->find(val);
+        assert(index != swiss::NONE);
         return set[index];
     }
 
+    // return nullptr if there's no equal value
     T const* get(T val) const {
-        todo;
-        assert(capacity > 0);
-        u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        assert(exists[index]);
-        return &set[index];
+        u32 index = this->find(val);
+        return index == swiss::NONE ? nullptr : &set[index];
     }
-    
+
+    // return nullptr if there's no equal value
     T* get(T val) {
-        assert(capacity > 0);
-        u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        assert(exists[index]);
-        return &set[index];
+        u32 index = this->find(val);
+        return index == swiss::NONE ? nullptr : &set[index];
     }
 
     bool has(T val) const {
-        if(capacity == 0) return false;
-        u64 hash = hash::from(val);
-        usize init_index = hash%capacity;
-        usize index = init_index;
-        // find the next available spot using quadratic probing, if initial is taken (or do nothing otherwise)
-        for(u32 attempts = 1; tombstone[index] && !(exists[index] && set[index] == val); attempts++) {
-            index = (init_index + c1 * attempts + c2 * attempts * attempts)%capacity;
-        }
-        return exists[index];
+        return this->find(val) != swiss::NONE;
     }
 
     /* Cloning */
@@ -149,16 +114,13 @@ struct HSet {
     // if `new_arena` is `nullptr`, use the same arena as `this`
     HSet<T> clone(mem::Arena* new_arena = nullptr) {
         if(new_arena == nullptr) new_arena = arena;
-        HSet<T> cloned = HSet<T> {
-            .set = new_arena->alloc<T>(capacity),
-            .exists = exists.clone(new_arena),
-            .tombstone = tombstone.clone(new_arena),
-            .size = size,
-            .capacity = capacity,
-            .arena = new_arena
-        };
+        HSet<T> cloned = *this;
+        cloned.arena = new_arena;
+        if(capacity == 0) return cloned;
+        cloned.set = new_arena->alloc<T>(capacity);
+        cloned.ctrl = new_arena->alloc<u8>(capacity);
         mem::copy(cloned.set, set, capacity);
-        assert(cloned.arena != nullptr);
+        mem::copy(cloned.ctrl, ctrl, capacity);
         return cloned;
     }
-};
\ No newline at end of file
+};
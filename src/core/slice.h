@@ -66,11 +66,16 @@ struct Slice {
     /* hash Compatibility */
 
     u64 hash() {
-        u64 acc_hash = 0;
-        for(usize i = 0; i < size; i++) {
-            acc_hash ^= std::rotl(hash::from(data[i]), i);
+        // plain data can be hashed as bytes; everything else element by element
+        if constexpr(std::has_unique_object_representations_v<T>) {
+            return hash::bytes(data, size * sizeof(T));
+        } else {
+            u64 acc_hash = hash::from(size);
+            for(usize i = 0; i < size; i++) {
+                acc_hash = hash::combine(acc_hash, hash::from(data[i]));
+            }
+            return acc_hash;
         }
-        return acc_hash;
     }
 };
 
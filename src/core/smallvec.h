@@ -0,0 +1,132 @@
+#pragma once
+
+#include "prelude.h"
+#include "mem.h"
+#include "slice.h"
+
+// Vector that keeps its first `N` elements inline, and only goes to the arena once it outgrows them
+// Meant for short lived stacks (e.g. the parser's operator and operand stacks), that are almost always small.
+// It can't be copied: a copy would get its own inline elements but share the heap ones. Use `clone`.
+// Moving it leaves the old one empty.
+// T must be trivially copyable
+template <typename T, usize N>
+struct SmallVec {
+    usize size;
+    usize capacity; // N while the elements are inline
+    union {
+        T inline_data[N];
+        T* heap; // owned; only valid when `capacity > N`
+    };
+
+    mem::Arena* arena;
+
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(N > 0);
+
+    SmallVec() = default;
+    SmallVec(SmallVec const&) = delete;
+    SmallVec& operator=(SmallVec const&) = delete;
+    SmallVec(SmallVec&& other) : size(other.size), capacity(other.capacity), arena(other.arena) {
+        if(other.is_inline()) mem::copy(inline_data, other.inline_data, size);
+        else heap = other.heap;
+        other.size = 0;
+        other.capacity = N;
+    }
+
+    static SmallVec create(mem::Arena& arena = default_arena) {
+        SmallVec<T,N> v;
+        v.size = 0;
+        v.capacity = N;
+        v.arena = &arena;
+        return v;
+    }
+
+    // if `new_arena` is `nullptr`, use the same arena as `this`
+    SmallVec clone(mem::Arena* new_arena = nullptr) {
+        new_arena = (new_arena == nullptr ? this->arena : new_arena);
+        if(new_arena == nullptr) new_arena = &default_arena;
+        SmallVec<T,N> v = SmallVec<T,N>::create(*new_arena);
+        v.reserve(size);
+        mem::copy(v.data(), this->data(), size);
+        v.size = size;
+        return v;
+    }
+
+    bool is_inline() const {
+        return capacity == N;
+    }
+
+    T* data() {
+        return this->is_inline() ? inline_data : heap;
+    }
+    T const* data() const {
+        return this->is_inline() ? inline_data : heap;
+    }
+
+    void reserve(usize new_capacity) {
+        if(new_capacity <= capacity) return;
+        if(arena == nullptr) arena = &default_arena;
+        if(this->is_inline()) {
+            T* new_heap = arena->alloc<T>(new_capacity);
+            mem::copy(new_heap, inline_data, size);
+            heap = new_heap;
+        } else {
+            heap = arena->realloc(heap, capacity, new_capacity);
+        }
+        capacity = new_capacity;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    void push(T const& e) {
+        T copy = e; // `e` might be one of the elements, which `reserve` moves
+        if(size == capacity) this->reserve(capacity * 2);
+        this->data()[size] = copy;
+        size++;
+    }
+
+    T pop() {
+        assert(size > 0);
+        size--;
+        return this->data()[size];
+    }
+
+    void clear() {
+        size = 0;
+    }
+
+    /* Access Member Functions */
+
+    T const& operator[](usize i) const {
+        assert(i < size);
+        return this->data()[i];
+    }
+
+    T& operator[](usize i) {
+        assert(i < size);
+        return this->data()[i];
+    }
+
+    T const& back() const {
+        assert(size > 0);
+        return this->data()[size-1];
+    }
+
+    T& back() {
+        assert(size > 0);
+        return this->data()[size-1];
+    }
+
+    /* Slice compatibility */
+
+    Slice<T> full_slice() {
+        return Slice<T> { .data = this->data(), .size = size };
+    }
+
+    /* STL Compatibility */
+
+    T* begin() { return this->data(); }
+    T* end() { return this->data() + size; }
+};
@@ -52,8 +52,8 @@ namespace str {
 
     template <typename... Args>
     Str cat(mem::Arena& arena, Args&&... strs) {
-        mem::Arena scratch = mem::Arena::create(10 KB);
-        Vec<Str> vec = Vec<Str>::create(scratch);
+        mem::Scratch scratch;
+        Vec<Str> vec = Vec<Str>::create(*scratch.arena);
         (vec.push(std::forward<Args>(strs)), ...);
         return str::from_slice_of_str(ref(vec.full_slice()), arena);
     }
@@ -76,6 +76,17 @@ namespace str {
         return v.full_slice();
     }
 
+    // shortest form that still reads back as the same value
+    Str from_float(f64 num, mem::Arena& arena = default_arena) {
+        char buf[32];
+        i32 size = snprintf(buf, sizeof(buf), "%.17g", num);
+        for(i32 precision = 1; precision < 17; precision++) {
+            i32 n = snprintf(buf, sizeof(buf), "%.*g", precision, num);
+            if(strtod(buf, nullptr) == num) { size = n; break; }
+        }
+        return str::clone_cstr(buf, size, arena);
+    }
+
     template <typename T>
     T to_int(Str str) {
         T num = 0;
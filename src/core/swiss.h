@@ -0,0 +1,116 @@
+#pragma once
+
+#include "prelude.h"
+#include "mem.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Control bytes shared by `HMap` and `HSet` (SwissTable layout)
+// Every slot has a control byte: EMPTY, DELETED, or the low 7 bits of the hash of its key (h2) when full.
+// Slots are split into groups of 16 whose control bytes are checked all at once; the rest of the hash (h1) picks the first group.
+// Capacity is always a power of two and a multiple of `GROUP`.
+namespace swiss {
+    constexpr u8 EMPTY = 0x80;
+    constexpr u8 DELETED = 0xFE;
+    constexpr u32 GROUP = 16;
+    constexpr u32 NONE = U32_MAX;
+
+    u64 h1(u64 h) { return h >> 7; }
+    u8 h2(u64 h) { return h & 0x7F; }
+
+    // bit i of every mask = byte i of the group
+    struct Group {
+        #ifdef __SSE2__
+        __m128i ctrl;
+
+        static Group load(u8 const* ctrl) {
+            return Group { .ctrl = _mm_loadu_si128((__m128i const*) ctrl) };
+        }
+        u32 match(u8 b) const {
+            return (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) b)));
+        }
+        // EMPTY or DELETED; those are the only ones with the high bit set
+        u32 match_free() const {
+            return (u32) _mm_movemask_epi8(ctrl);
+        }
+        #else
+        u8 const* ctrl;
+
+        static Group load(u8 const* ctrl) {
+            return Group { .ctrl = ctrl };
+        }
+        u32 match(u8 b) const {
+            u32 mask = 0;
+            for(u32 i = 0; i < GROUP; i++) mask |= (u32) (ctrl[i] == b) << i;
+            return mask;
+        }
+        u32 match_free() const {
+            u32 mask = 0;
+            for(u32 i = 0; i < GROUP; i++) mask |= (u32) (ctrl[i] >> 7) << i;
+            return mask;
+        }
+        #endif
+        u32 match_empty() const {
+            return this->match(EMPTY);
+        }
+    };
+
+    // triangular probing over groups; visits every group exactly once since the number of groups is a power of two
+    struct Probe {
+        u64 group;
+        u64 mask;
+        u64 step;
+
+        u32 offset() const { return group * GROUP; }
+        void next() { step++; group = (group + step) & mask; }
+    };
+
+    Probe probe(u64 hash, u32 capacity) {
+        u64 mask = capacity / GROUP - 1;
+        return Probe { .group = swiss::h1(hash) & mask, .mask = mask, .step = 0 };
+    }
+
+    u8* alloc_ctrl(mem::Arena& arena, u32 capacity) {
+        u8* ctrl = arena.alloc<u8>(capacity);
+        std::memset(ctrl, EMPTY, capacity);
+        return ctrl;
+    }
+
+    // slots that may be either full or deleted before the table has to be rebuilt (7/8 load)
+    u32 max_used(u32 capacity) {
+        return capacity - capacity / 8;
+    }
+
+    // index of the full slot for which `eq(index)` holds, or `NONE`
+    template <typename F>
+    u32 find(u8 const* ctrl, u32 capacity, u64 hash, F&& eq) {
+        if(capacity == 0) return NONE;
+        u8 tag = swiss::h2(hash);
+        for(Probe p = swiss::probe(hash, capacity);; p.next()) {
+            Group g = Group::load(ctrl + p.offset());
+            for(u32 m = g.match(tag); m != 0; m &= m - 1) {
+                u32 i = p.offset() + std::countr_zero(m);
+                if(eq(i)) return i;
+            }
+            if(g.match_empty() != 0) return NONE; // the key would have been put here
+            assert(p.step <= p.mask); // the table is never completely full
+        }
+    }
+
+    // index of the first EMPTY or DELETED slot on the probe sequence of `hash`
+    u32 find_free(u8 const* ctrl, u32 capacity, u64 hash) {
+        for(Probe p = swiss::probe(hash, capacity);; p.next()) {
+            u32 m = Group::load(ctrl + p.offset()).match_free();
+            if(m != 0) return p.offset() + std::countr_zero(m);
+        }
+    }
+
+    // what a removed slot should turn into
+    // if its group has an EMPTY slot, the group was never full, so no probe sequence ever went past it; no tombstone needed
+    u8 erased(u8 const* ctrl, u32 index) {
+        u32 start = index & ~(GROUP - 1);
+        return Group::load(ctrl + start).match_empty() != 0 ? EMPTY : DELETED;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "prelude.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+// Fixed number of worker threads taking jobs off a shared queue
+// Jobs run on whichever worker is free, so a job may only touch thread_local state it sets up itself (e.g. a
+// `CompilationContext`) and whatever it was handed. Workers are joined when the pool goes out of scope.
+// `ThreadPool pool(4); pool.submit([] { ... }); pool.wait();`
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex lock; // guards `jobs`, `busy` and `stopping`
+    std::condition_variable job_ready;
+    std::condition_variable all_done;
+    u32 busy = 0; // number of jobs being run right now
+    bool stopping = false;
+
+    // `threads == 0` means one per hardware thread
+    ThreadPool(u32 threads = 0) {
+        if(threads == 0) threads = ThreadPool::hardware_threads();
+        workers.reserve(threads);
+        for(u32 i = 0; i < threads; i++) workers.emplace_back([this] { this->work(); });
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        job_ready.notify_all();
+        for(std::thread& t : workers) t.join();
+    }
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    static u32 hardware_threads() {
+        return max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    u32 size() const {
+        return workers.size();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(std::move(job));
+        }
+        job_ready.notify_one();
+    }
+
+    // block until every submitted job has finished
+    void wait() {
+        std::unique_lock<std::mutex> guard(lock);
+        all_done.wait(guard, [this] { return jobs.empty() && busy == 0; });
+    }
+
+    void work() {
+        while(true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                job_ready.wait(guard, [this] { return stopping || !jobs.empty(); });
+                if(jobs.empty()) return; // stopping
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy++;
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                busy--;
+                if(jobs.empty() && busy == 0) all_done.notify_all();
+            }
+        }
+    }
+};
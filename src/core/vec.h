@@ -4,6 +4,8 @@
 #include "mem.h"
 #include "slice.h"
 
+// Copying a `Vec` is shallow: both copies share `data`. Once any of them grows, the old buffer goes back to the arena
+// and may be handed out again, so the other copies must not be used after that.
 template <typename T>
 struct Vec {
     T* data; // nullable, owned
@@ -63,20 +65,22 @@ struct Vec {
     }
 
     void push(T const&& e) {
+        T copy = e; // `e` might be in `data`, which `reserve` frees
         if(size == capacity) {
             if(capacity == 0) this->reserve(8);
             else this->reserve(capacity*2);
         }
-        data[size] = e;
+        data[size] = copy;
         size++;
     }
 
     void push(T const& e) {
+        T copy = e; // `e` might be in `data`, which `reserve` frees
         if(size == capacity) {
             if(capacity == 0) this->reserve(8);
             else this->reserve(capacity*2);
         }
-        data[size] = e;
+        data[size] = copy;
         size++;
     }
 
@@ -87,7 +91,7 @@ struct Vec {
     }
 
     void push_slice(Slice<T> s) {
-        if(next_power_of_two(this->size + s.size) < this->capacity)
+        if(this->size + s.size > this->capacity)
             this->reserve(next_power_of_two(this->size + s.size));
         
         for(usize i = 0; i < s.size; i++) {
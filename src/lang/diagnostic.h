@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/str.h"
+#include "../core/slice.h"
+
+// A parse error
+// Only the byte offset is kept; the line and column are worked out when it's printed (one pass over the source up to
+// the last error), so a program without errors never pays for them.
+struct Diagnostic {
+    Str message;
+    u64 offset; // into the whole source
+};
+
+namespace diag {
+    // print `line:col: error: message` for each of `diags`, then that line of source with a caret under the column
+    // `diags` have to be in source order (the parser reports them that way)
+    // `read(at, buf, size)` copies up to `size` bytes of source from offset `at` into `buf`; returns 0 past the end
+    template <typename Read>
+    void print(std::ostream& out, Slice<Diagnostic> diags, Read read) {
+        u8 buf[4 KB];
+        u64 at = 0; // everything before this has been counted
+        u32 line = 1;
+        u64 line_start = 0;
+        for(Diagnostic& d : diags) {
+            while(at < d.offset) {
+                usize got = read(at, buf, min((u64) sizeof(buf), d.offset - at));
+                if(got == 0) break;
+                for(usize i = 0; i < got; i++) {
+                    if(buf[i] == '\n') { line++; line_start = at + i + 1; }
+                }
+                at += got;
+            }
+            u64 col = d.offset - line_start;
+            out << line << ":" << col + 1 << ": error: " << d.message << "\n";
+
+            // the line, or its first 120 bytes; the caret is indented with the line's own tabs so it lines up
+            usize got = read(line_start, buf, 120);
+            usize end = 0;
+            while(end < got && buf[end] != '\n') end++;
+            out << "    " << Str { .data = buf, .size = end } << "\n    ";
+            for(usize i = 0; i < min(col, (u64) end); i++) out << (buf[i] == '\t' ? '\t' : ' ');
+            out << "^\n";
+        }
+        out << diags.size << (diags.size == 1 ? " error" : " errors") << std::endl;
+    }
+}
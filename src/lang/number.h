@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/str.h"
+#include "../core/maybe.h"
+
+#include "util.h"
+
+#include <cstring>
+
+// number literal parsing
+// integers go 8 decimal digits at a time (SWAR: the 8 bytes are converted as one u64) and report overflow
+// TODO floats; the tokenizer lexes them, but nothing parses them yet
+namespace num {
+    // the 8 digit characters at `p` as a number; `p[0]` is the most significant one
+    u64 eight_digits(u8 const* p) {
+        u64 v;
+        std::memcpy(&v, p, 8);
+        v = (v & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8; // pairs of digits
+        v = (v & 0x00FF00FF00FF00FF) * 6553601 >> 16; // groups of 4
+        return (v & 0x0000FFFF0000FFFF) * 42949672960001 >> 32;
+    }
+
+    // whether the 8 bytes at `p` are all digits
+    bool all_digits(u8 const* p) {
+        u64 v;
+        std::memcpy(&v, p, 8);
+        return (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+    }
+
+    Maybe<u64> parse_decimal(Str s) {
+        if(s.size == 0) return Maybe<u64>::none();
+        u64 v = 0;
+        usize i = 0;
+        for(; i + 8 <= s.size && num::all_digits(s.data + i); i += 8) {
+            if(__builtin_mul_overflow(v, (u64) 100000000, &v) || __builtin_add_overflow(v, num::eight_digits(s.data + i), &v)) return Maybe<u64>::none();
+        }
+        for(; i < s.size; i++) {
+            if(!ch::num(s[i])) return Maybe<u64>::none();
+            if(__builtin_mul_overflow(v, (u64) 10, &v) || __builtin_add_overflow(v, (u64) (s[i] - '0'), &v)) return Maybe<u64>::none();
+        }
+        return Maybe<u64>::some(v);
+    }
+
+    // digits after `0x` or `0b`; `bits` is 4 or 1
+    Maybe<u64> parse_radix(Str s, u32 bits) {
+        if(s.size == 0) return Maybe<u64>::none();
+        u64 v = 0;
+        for(u8 c : s) {
+            u64 d = ch::num(c) ? c - '0' : ((c | 0x20) - 'a' + 10);
+            if(!ch::hex(c) || d >= (1ULL << bits)) return Maybe<u64>::none();
+            if(v >> (64 - bits) != 0) return Maybe<u64>::none(); // it'd shift out
+            v = (v << bits) | d;
+        }
+        return Maybe<u64>::some(v);
+    }
+
+    // a decimal, `0x` hex or `0b` binary integer literal; none if it's malformed or doesn't fit in 64 bits
+    Maybe<u64> parse_int(Str s) {
+        if(s.size > 2 && s[0] == '0' && (s[1] | 0x20) == 'x') return num::parse_radix(s.slice(2, s.size - 2), 4);
+        if(s.size > 2 && s[0] == '0' && (s[1] | 0x20) == 'b') return num::parse_radix(s.slice(2, s.size - 2), 1);
+        return num::parse_decimal(s);
+    }
+}
@@ -3,6 +3,8 @@
 #include "../core/prelude.h"
 #include "../core/str.h"
 
+#include <array>
+
 enum class Op {
     // Ambiguous
     Undefined, Minus, Star, Ampersand,
@@ -20,12 +22,13 @@ enum class Op {
 
     Assignment, // special; RIGHT ASSOCIATIVE
 };
+constexpr u32 OP_COUNT = (u32) Op::Assignment + 1;
 
 std::ostream& operator<<(std::ostream& os, Op op);
 
 namespace op {
     // high priority = apply first
-    u8 p(Op op) {
+    constexpr u8 p(Op op) {
         switch(op) {
             case Op::Neg:
             case Op::LogiNot:
@@ -66,7 +69,7 @@ namespace op {
         }
     }
 
-    bool unary(Op op) {
+    constexpr bool unary(Op op) {
         switch(op) {
             case Op::Neg:
             case Op::LogiNot:
@@ -98,7 +101,7 @@ namespace op {
         }
     }
 
-    bool binary(Op op) {
+    constexpr bool binary(Op op) {
         switch(op) {
             case Op::Neg:
             case Op::LogiNot:
@@ -130,7 +133,7 @@ namespace op {
         }
     }
 
-    bool ambiguous(Op op) {
+    constexpr bool ambiguous(Op op) {
         switch(op) {
             case Op::Undefined:
             case Op::Minus:
@@ -176,11 +179,26 @@ namespace op {
         panic;
     }
 
-    // return true if `left` has precedence over `right`
-    // aka in expression `a left b right c` we apply `(a left b) right c`
-    bool has_precedence(Op left, Op right) {
-        if(op::p(left) == 0) return false; // `=` is right associative AND lowest priority
-        return op::p(left) >= op::p(right);
+    // how an op binds as a binary operator; for the expression parser
+    struct Binding {
+        u8 prec; // `op::p` + 1, so that 0 means it's not a binary op
+        bool right_assoc; // `a op b op c` is `a op (b op c)`
+    };
+
+    constexpr std::array<Binding,OP_COUNT> make_bindings() {
+        std::array<Binding,OP_COUNT> b {};
+        for(u32 i = 0; i < OP_COUNT; i++) {
+            Op op = (Op) i;
+            if(op::ambiguous(op) || !op::binary(op)) continue;
+            b[i] = Binding { .prec = (u8) (op::p(op) + 1), .right_assoc = op == Op::Assignment };
+        }
+        return b;
+    }
+    constexpr std::array<Binding,OP_COUNT> bindings = op::make_bindings();
+
+    // `op` has to be resolved (see `op::resolve`)
+    Binding binding(Op op) {
+        return op::bindings[(u32) op];
     }
 
     Str symbol(Op op) {
@@ -220,49 +238,50 @@ namespace op {
     }
 
     Op from_str(Str op) {
-        // Ambiguous
-        if (op == "-"_s) {
-            return Op::Minus;
-        } else if (op == "*"_s) {
-            return Op::Star;
-        } else if (op == "&"_s) {
-            return Op::Ampersand;
-        } else
-        // Unambiguous
-        if (op == "!"_s) {
-            return Op::LogiNot;
-        } else if (op == "~"_s) {
-            return Op::BitNot;
-        } else if (op == "+"_s) {
-            return Op::Add;
-        } else if (op == "/"_s) {
-            return Op::Div;
-        } else if (op == "%"_s) {
-            return Op::Mod;
-        } else if (op == "||"_s) {
-            return Op::LogiOr;
-        } else if (op == "&&"_s) {
-            return Op::LogiAnd;
-        } else if (op == "|"_s) {
-            return Op::BitOr;
-        } else if (op == "^"_s) {
-            return Op::BitXor;
-        } else if (op == "="_s) {
-            return Op::Assignment;
-        } else if (op == "=="_s) {
-            return Op::Eq;
-        } else if (op == "!="_s) {
-            return Op::Neq;
-        } else if (op == "<"_s) {
-            return Op::Less;
-        } else if (op == ">"_s) {
-            return Op::Greater;
-        } else if (op == "<="_s) {
-            return Op::LessEq;
-        } else if (op == ">="_s) {
-            return Op::GreaterEq;
-        } else {
-            return Op::Undefined;
+        if(op.size == 1) {
+            switch(op.data[0]) {
+                // Ambiguous
+                case '-': return Op::Minus;
+                case '*': return Op::Star;
+                case '&': return Op::Ampersand;
+                // Unambiguous
+                case '!': return Op::LogiNot;
+                case '~': return Op::BitNot;
+                case '+': return Op::Add;
+                case '/': return Op::Div;
+                case '%': return Op::Mod;
+                case '|': return Op::BitOr;
+                case '^': return Op::BitXor;
+                case '=': return Op::Assignment;
+                case '<': return Op::Less;
+                case '>': return Op::Greater;
+                default: return Op::Undefined;
+            }
+        }
+        if(op.size == 2 && op.data[1] == '=') {
+            switch(op.data[0]) {
+                case '=': return Op::Eq;
+                case '!': return Op::Neq;
+                case '<': return Op::LessEq;
+                case '>': return Op::GreaterEq;
+                default: return Op::Undefined;
+            }
+        }
+        if(op == "||"_s) return Op::LogiOr;
+        if(op == "&&"_s) return Op::LogiAnd;
+        return Op::Undefined;
+    }
+
+    // the op that `str` stands for, Undefined if there's none that can go there
+    // this is where the ambiguous ones are decided: right after an operand they're binary, anywhere else unary
+    Op resolve(Str str, bool after_operand) {
+        Op op = op::from_str(str);
+        switch(op) {
+            case Op::Undefined: return Op::Undefined;
+            case Op::Minus: return after_operand ? Op::Sub : Op::Neg;
+            case Op::Star: return after_operand ? Op::Mul : Op::Undefined; // no dereferencing yet
+            case Op::Ampersand: return after_operand ? Op::BitAnd : Op::Undefined; // no taking addresses yet
+            default: return (after_operand ? op::binary(op) : op::unary(op)) ? op : Op::Undefined;
         }
     }
 
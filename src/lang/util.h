@@ -3,31 +3,65 @@
 #include "../core/prelude.h"
 #include "../core/str.h"
 
+#include <array>
+
 // character category helper functions
+// every predicate is a single lookup in `ch::classes`
 namespace ch {
+    // bits of `ch::classes`
+    enum Class : u8 {
+        White = 1 << 0, // ` `, `\n`, `\t`, `\r`
+        Num = 1 << 1,
+        Alpha = 1 << 2, // letters and `_`
+        Bracket = 1 << 3,
+        Delim = 1 << 4, // `;`, `,`
+        Terminal = 1 << 5, // ends an expression: closing brackets, delimiters and `\0`
+        Hex = 1 << 6, // hex digits, either case
+    };
+
+    constexpr std::array<u8,256> make_classes() {
+        std::array<u8,256> c {};
+        for(u8 x : { ' ', '\n', '\t', '\r' }) c[x] |= White;
+        for(u32 x = '0'; x <= '9'; x++) c[x] |= Num;
+        for(u32 x = 'a'; x <= 'z'; x++) c[x] |= Alpha;
+        for(u32 x = 'A'; x <= 'Z'; x++) c[x] |= Alpha;
+        c['_'] |= Alpha;
+        for(u32 x = '0'; x <= '9'; x++) c[x] |= Hex;
+        for(u32 x = 'a'; x <= 'f'; x++) c[x] |= Hex;
+        for(u32 x = 'A'; x <= 'F'; x++) c[x] |= Hex;
+        for(u8 x : { '(', ')', '[', ']', '{', '}' }) c[x] |= Bracket;
+        for(u8 x : { ';', ',' }) c[x] |= Delim;
+        for(u8 x : { ')', ']', '}', ';', ',', '\0' }) c[x] |= Terminal;
+        return c;
+    }
+    constexpr std::array<u8,256> classes = ch::make_classes();
+
     bool eof(u8 ch) {
         return ch == '\0';
     }
     bool white(u8 ch) {
-        return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r';
+        return ch::classes[ch] & White;
     }
     bool num(u8 ch) {
-        return ch >= '0' && ch <= '9';
+        return ch::classes[ch] & Num;
     }
     bool alpha(u8 ch) {
-        return ch == '_' || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+        return ch::classes[ch] & Alpha;
+    }
+    bool hex(u8 ch) {
+        return ch::classes[ch] & Hex;
     }
     bool alphanum(u8 ch) {
-        return ch::num(ch) || ch::alpha(ch);
+        return ch::classes[ch] & (Num | Alpha);
     }
     bool bracket(u8 ch) {
-        return ch == '[' || ch == ']' || ch == '{' || ch == '}' || ch == '(' || ch == ')';
+        return ch::classes[ch] & Bracket;
     }
     bool delim(u8 ch) {
-        return ch == ';' || ch == ',';
+        return ch::classes[ch] & Delim;
     }
     // symbols that terminate an "expression"
     bool terminal(u8 ch) {
-        return ch == ')' || ch == ']' || ch == '}' || ch::delim(ch) || ch::eof(ch);
+        return ch::classes[ch] & Terminal;
     }
-}
\ No newline at end of file
+}
@@ -7,64 +7,102 @@
 #include "core/slice.h"
 #include "core/debug.h"
 #include "core/map.h"
+#include "core/profile.h"
+#include "core/thread_pool.h"
 
-#include "son/parser.h"
-#include "son/global_code_motion.h"
+#include "compile/context.h"
 
-#include "compile/dump.h"
-#include "compile/dot.h"
-#include "compile/graph_evaluator.h"
+#include <sstream>
 
-Str readFile(const char* path, mem::Arena& arena = default_arena) {
-    std::ifstream infile(path);
-    return str::clone_cstr(std::string(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>()).data(), arena);
+// files at least this big are read a chunk at a time as they're compiled instead of loaded whole
+constexpr usize STREAM_MIN = 256 MB;
+
+// compile the file at `path` with `ctx`; `stream` streams it whatever its size
+bool compile_file(CompilationContext& ctx, char const* path, bool stream, CompilationContext::Options const& options, std::ostream& out) {
+    struct stat st;
+    if(!stream && (::stat(path, &st) != 0 || !S_ISREG(st.st_mode) || (usize) st.st_size < STREAM_MIN)) {
+        Source source;
+        {
+            profile::Phase phase("read"_s);
+            source = Source::load(path);
+        }
+        bool ok = source.ok && ctx.compile(source.text, options, out);
+        source.close();
+        return ok;
+    }
+    i32 fd = ::open(path, O_RDONLY);
+    if(fd < 0) {
+        printe("could not open", path);
+        return false;
+    }
+    return ctx.compile(fd, options, out);
 }
 
-void writeFile(const char* path, Str content) {
-    std::ofstream outfile(path);
-    outfile << content;
+// compile every file in `paths` on a pool of `threads` workers and print their output in order; false if any failed
+bool compile_batch(Vec<char const*>& paths, u32 threads, bool stream, CompilationContext::Options const& options) {
+    std::vector<std::string> outputs(paths.size);
+    std::vector<u8> ok(paths.size, false);
+    {
+        ThreadPool pool(min(threads, (u32) paths.size));
+        for(u32 i = 0; i < paths.size; i++) {
+            pool.submit([&, i] {
+                CompilationContext ctx = CompilationContext::create();
+                mem::Arena::Mark mark = default_arena.mark();
+                std::ostringstream out;
+                ok[i] = compile_file(ctx, paths[i], stream, options, out);
+                outputs[i] = out.str();
+                default_arena.rewind(mark);
+            });
+        }
+        pool.wait();
+    }
+    bool all_ok = true;
+    for(u32 i = 0; i < paths.size; i++) {
+        std::cout << "== " << paths[i] << (ok[i] ? "" : " (failed)") << " ==\n" << outputs[i];
+        all_ok = all_ok && ok[i];
+    }
+    return all_ok;
 }
 
 int main(int argc, char* argv[]) {
-    mem::Arena node_arena = mem::Arena::create(10 MB);
-    mem::Arena scope_arena = mem::Arena::create(10 MB);
-    mem::Arena type_arena = mem::Arena::create(10 MB);
-    type::pool = TypePool::create(type_arena);
-    Node::init(node_arena);
-    Type* inputs[2] = { type::pool.ctrl, (Type*) type::pool.get_bottom(TypeT::Int) };
-    START_NODE = NodeStart::create(Slice<Type*>::from_ptr(inputs, 2));
-    STOP_NODE = NodeStop::create();
-    SCOPE_NODE = NodeScope::create(scope_arena, NodeProj::create(0, START_NODE, true));
-    SCOPE_NODE->define("arg"_s, NodeProj::create(1, START_NODE, false));
-    SCOPE_NODE->define("$1"_s, NodeConst::create(type::pool.mem(type::pool.int_const(0)))); // manually load the alias class $1
-    BREAK_SCOPE_NODE = CONTINUE_SCOPE_NODE = nullptr;
-
-    Str src = readFile("mir/hello.mir");
-
-    Parser p = Parser::create(src);
-
-    Node* n = nullptr;
-    do {
-        n = p.next_top_level_expr();
-    } while(n != nullptr && !p.done());
-    
-    if(p.err()) {
-        printd(p.error);
-        std::cout << "at:\n" << p.t.source.slice(p.t.at, 10) << std::endl;
+    char const* program_input = nullptr; // run the evaluator with this as `arg`
+    bool time_report = false; // print how long each phase took and write ./time-report.json
+    u32 threads = 0; // `-j`; 0 = one per hardware thread
+    bool stream = false; // `--stream`; read every file a chunk at a time, not just big ones
+    Vec<char const*> paths = Vec<char const*>::create(); // *.mir files to compile; mir/hello.mir if there are none
+    for(i32 i = 1; i < argc; i++) {
+        Str arg = str::from_cstr(argv[i]);
+        if(std::strcmp(argv[i], "--time-report") == 0) time_report = true;
+        else if(std::strcmp(argv[i], "--stream") == 0) stream = true;
+        else if(std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if(arg.size > 4 && arg.slice(arg.size - 4, 4) == ".mir"_s) paths.push(argv[i]);
+        else program_input = argv[i];
     }
+    if(paths.empty()) paths.push("mir/hello.mir");
 
-    SCOPE_NODE->pop();
-
-    Str dot = compile::dot(START_NODE);
-    writeFile("./graph.gv", dot);
+    if(time_report) {
+        profile::enable();
+        profile::track("nodes"_s, [] { return (u64) Node::uid_counter; });
+        profile::track("types"_s, [] { return (u64) type::pool.size(); });
+    }
 
-    if(argc > 1) {
-        u64 program_input = atoi(argv[1]);
-        u64 output_value = Evaluator::create_and_run(START_NODE, program_input, 100000);
-        std::cout << "Program output: " << output_value << std::endl;
+    bool ok;
+    if(paths.size == 1) {
+        // on this thread, so the phases show up in the time report
+        CompilationContext ctx = CompilationContext::create();
+        ctx.track();
+        ok = compile_file(ctx, paths[0], stream, CompilationContext::Options { .program_input = program_input, .dot_path = "./graph.gv" }, std::cout);
+    } else {
+        // the workers aren't profiled; only the batch as a whole is
+        profile::track(default_arena);
+        profile::Phase phase("batch"_s);
+        ok = compile_batch(paths, threads == 0 ? ThreadPool::hardware_threads() : threads, stream, CompilationContext::Options { .program_input = program_input, .dot_path = nullptr });
     }
 
-    node::compute_idom();
-    gcm::build((NodeStart*) START_NODE, (NodeStop*) STOP_NODE);
-    std::cout << compile::dump(START_NODE);
-}
\ No newline at end of file
+    if(time_report) {
+        profile::report(std::cout);
+        std::ofstream trace("./time-report.json");
+        profile::trace(trace);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "node.h"
+
+// Dead node compaction
+// Killed nodes stay on `Node::node_arena` and `Node::uid_counter` only ever grows, so everything indexed by uid (the
+// `BitSet`s, `gcm::schedule_late`'s arrays) keeps getting bigger as the optimizer runs. Once it's done, copy the live
+// graph to a fresh arena with dense uids and give the old arena's memory back.
+//
+// Live = reachable from Stop through inputs, same as `sccp::sweep`. Scope nodes are dropped; the parser is done with
+// them. Nodes are laid out in reverse postorder of the def-use walk from Start, each followed by its edges, so a walk
+// over the graph mostly moves forward in memory.
+// Renumbering changes the canonical order of commutative inputs (see `node::idealize`), so don't peephole afterwards.
+namespace compact {
+    struct Stats {
+        u32 live; // number of nodes copied
+        u32 dropped; // number of uids that were handed out but didn't make it
+        usize bytes_before; // used by the old arena
+        usize bytes_after; // used by the new arena
+    };
+
+    // size of the concrete node struct
+    usize size_of(NodeType nt) {
+        switch(nt) {
+            case NodeType::Start: return sizeof(NodeStart);
+            case NodeType::Stop: return sizeof(NodeStop);
+            case NodeType::Ret: return sizeof(NodeRet);
+            case NodeType::If: return sizeof(NodeIf);
+            case NodeType::Region: case NodeType::Loop: return sizeof(NodeRegion);
+            case NodeType::CtrlProj: case NodeType::Proj: return sizeof(NodeProj);
+            case NodeType::Const: return sizeof(NodeConst);
+            case NodeType::BinOp: return sizeof(NodeBinOp);
+            case NodeType::UnOp: return sizeof(NodeUnOp);
+            case NodeType::Phi: return sizeof(NodePhi);
+            case NodeType::Load: return sizeof(NodeLoad);
+            case NodeType::Store: return sizeof(NodeStore);
+            case NodeType::AllocA: return sizeof(NodeAllocA);
+            default:
+                printe("compaction only works on the ideal graph", nt);
+                panic;
+        }
+    }
+
+    // mark everything reachable from `stop` through inputs and return it; iterative, since the graph can get deep
+    void mark_live(Node* stop, BitSet& live, Vec<Node*>& all, mem::Arena& scratch) {
+        Vec<Node*> work = Vec<Node*>::create(scratch);
+        work.push(stop);
+        live.set(stop->uid);
+        while(!work.empty()) {
+            Node* n = work.pop();
+            all.push(n);
+            for(Node* in : n->input) {
+                if(in == nullptr || live[in->uid] || in->nt == NodeType::Scope) continue;
+                live.set(in->uid);
+                work.push(in);
+            }
+        }
+    }
+
+    // reverse postorder of the live nodes, following outputs from `start`
+    void order(Node* start, BitSet& live, Vec<Node*>& rpo, mem::Arena& scratch) {
+        struct Frame {
+            Node* n;
+            u32 next; // index of the next output to visit
+        };
+        Vec<Frame> stack = Vec<Frame>::create(scratch);
+        BitSet visit = BitSet::create(Node::uid_counter + 1, scratch);
+        visit.set(start->uid);
+        stack.push(Frame { .n = start, .next = 0 });
+        while(!stack.empty()) {
+            Frame& f = stack.back();
+            if(f.next == f.n->output.size) {
+                rpo.push(f.n);
+                stack.pop();
+                continue;
+            }
+            Node* out = f.n->output[f.next++];
+            if(!live[out->uid] || visit[out->uid]) continue;
+            visit.set(out->uid);
+            stack.push(Frame { .n = out, .next = 0 });
+        }
+        rpo.reverse();
+    }
+
+    // copy the live graph to `to`, which becomes the node arena; the old node arena is reset
+    // `START_NODE` and `STOP_NODE` are updated; the scope nodes are gone, so the `*SCOPE_NODE`s are cleared
+    Stats run(Node* start, Node* stop, mem::Arena& to) {
+        Stats stats {};
+        mem::Arena& from = *Node::node_arena;
+        stats.bytes_before = from.used();
+        u32 old_count = Node::uid_counter;
+
+        mem::Scratch scratch;
+        BitSet live = BitSet::create(old_count + 1, *scratch.arena);
+        Vec<Node*> all = Vec<Node*>::create(*scratch.arena);
+        compact::mark_live(stop, live, all, *scratch.arena);
+        if(!live[start->uid]) { live.set(start->uid); all.push(start); }
+
+        Vec<Node*> nodes = Vec<Node*>::create(*scratch.arena);
+        compact::order(start, live, nodes, *scratch.arena);
+        {
+            // anything live that Start can't reach through outputs still has to come along
+            BitSet placed = BitSet::create(old_count + 1, *scratch.arena);
+            for(Node* n : nodes) placed.set(n->uid);
+            for(Node* n : all) {
+                if(!placed[n->uid]) nodes.push(n);
+            }
+        }
+
+        // copy the nodes, each followed by room for its edges
+        Node** moved = scratch.arena->alloc<Node*>(old_count + 1); // old uid -> new node
+        Node::uid_counter = 0;
+        for(Node* old : nodes) {
+            usize bytes = compact::size_of(old->nt);
+            Node* n = (Node*) to.alloc<u64>(ceil_div(bytes, sizeof(u64)));
+            mem::copy((u8*) n, (u8*) old, bytes);
+            moved[old->uid] = n;
+            n->uid = ++Node::uid_counter;
+            n->locked = false;
+            n->deps = nullptr;
+            u32 uses = 0;
+            for(Node* out : old->output) uses += live[out->uid];
+            n->input.capacity = n->input.size;
+            n->input.data = n->input.size == 0 ? nullptr : to.alloc<Node*>(Edges::words(n->input.size));
+            n->output = Edges { .data = uses == 0 ? nullptr : to.alloc<Node*>(Edges::words(uses)), .size = 0, .capacity = uses };
+        }
+
+        // relink; outputs keep their relative order
+        for(Node* old : nodes) {
+            Node* n = moved[old->uid];
+            for(u32 i = 0; i < old->input.size; i++) {
+                Node* in = old->input[i];
+                n->input[i] = in == nullptr ? nullptr : moved[in->uid];
+                n->input.back(i) = Edges::NO_BACK;
+            }
+        }
+        for(Node* old : nodes) {
+            Node* n = moved[old->uid];
+            for(u32 p = 0; p < old->output.size; p++) {
+                Node* out = old->output[p];
+                if(!live[out->uid]) continue;
+                Node* user = moved[out->uid];
+                u32 slot = old->output.back(p);
+                user->input.back(slot) = n->output.size;
+                n->output.push(user, slot);
+            }
+        }
+
+        // value number again; hashes depend on the uids of the inputs
+        Node::gvn = GVN::create(to);
+        for(Node* old : nodes) {
+            if(!old->locked) continue;
+            Node* found = moved[old->uid]->lock();
+            assert(found == moved[old->uid]);
+        }
+
+        START_NODE = moved[start->uid];
+        STOP_NODE = moved[stop->uid];
+        SCOPE_NODE = BREAK_SCOPE_NODE = CONTINUE_SCOPE_NODE = nullptr;
+        Node::node_arena = &to;
+        Edges::arena = &to;
+        from.reset();
+
+        stats.live = Node::uid_counter;
+        stats.dropped = old_count - Node::uid_counter;
+        stats.bytes_after = to.used();
+        return stats;
+    }
+
+    // in the namespace, so `profile::note` finds it
+    std::ostream& operator<<(std::ostream& os, Stats const& stats) {
+        return os << stats.live << " live nodes, " << stats.dropped << " dropped, "
+            << stats.bytes_before / 1024 << " KB -> " << stats.bytes_after / 1024 << " KB";
+    }
+}
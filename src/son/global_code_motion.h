@@ -9,7 +9,7 @@ namespace gcm {
     void schedule_early(NodeStart* start); // forward decl
     void schedule_late(NodeStop* start); // forward decl
 
-    BitSet anti_deps{.arena=&default_arena}; // marked CFG nodes (by CFGNode::cfgid) are visited on the path lca->START for some load/store node when computing its anti-dependencies
+    thread_local BitSet anti_deps{.arena=&default_arena}; // marked CFG nodes (by CFGNode::cfgid) are visited on the path lca->START for some load/store node when computing its anti-dependencies
 
     // In a bunch of functions there's a `for(Node a = ...; a < b->idom(); a = a->idom()) {...}`
     // The reason we're going up to `b->idom()` is the same reason we go until `vec.size` and not `vec.size-1`; off by 1 kind of thing, we still want to look at `a == b`, but not any further
@@ -61,19 +61,25 @@ namespace gcm {
     // find the earliest possible placement (ctrl) for every node
     // sets each data node's ctrl to be earlies possible
     void schedule_early(NodeStart* start) {
-        mem::Arena scratch = mem::Arena::create(1 MB);
+        mem::Scratch scratch;
         assert(node::cfg_size > 0); // `compute_idom` has been called
         Vec<Node*>& rpo = node::cfgrp; // rpo = reverse post order
-        BitSet visit { .arena = &scratch };
+        BitSet visit = BitSet::create(Node::uid_counter + 1, *scratch.arena);
+        Vec<Node*> phis = Vec<Node*>::create(*scratch.arena);
 
         for(u32 i = 0; i < rpo.size; i++) {
             Node* cfg = rpo[i];
             for(Node* n : cfg->input)
                 gcm::schedule_node_early(n, visit);
-            if(cfg->nt == NodeType::Region || cfg->nt == NodeType::Loop)
+            if(cfg->nt == NodeType::Region || cfg->nt == NodeType::Loop) {
+                // scheduling moves nodes in and out of `cfg->output`, so don't walk it directly
+                phis.clear();
                 for(Node* phi : cfg->output)
                     if(phi->nt == NodeType::Phi)
-                        gcm::schedule_node_early(phi, visit);
+                        phis.push(phi);
+                for(Node* phi : phis)
+                    gcm::schedule_node_early(phi, visit);
+            }
         }
     }
 
@@ -218,9 +224,9 @@ namespace gcm {
     }
 
     void walk_breadth(Node* stop, Node** ns, Node** late) {
-        mem::Arena scratch = mem::Arena::create(4 MB);
+        mem::Scratch scratch;
         // Things on the worklist have some (but perhaps not all) outputs done
-        Vec<Node*> work = Vec<Node*>::create(scratch);
+        Vec<Node*> work = Vec<Node*>::create(*scratch.arena);
         work.push(stop);
 
         while(!work.empty()) {
@@ -229,7 +235,9 @@ namespace gcm {
             if(late[n->uid] != nullptr) { continue; } // No double visit
             // std::cout << ">> " << n->uid << std::endl;
             // These we know the late schedule of, and need to set early for loops
-            if(n->cfg()) {
+            if(n->nt == NodeType::Stop) {
+                late[n->uid] = n; // has a ctrl input per return; nothing gets scheduled into it anyway
+            } else if(n->cfg()) {
                 // we want to get the head of a block we schedule, and n->ctrl() will always get the head when `n` is a tail
                 late[n->uid] = node::is_block_head(n) ? n : n->ctrl(); // note that calling `ctrl(void)` on CFG nodes will assert they have only (CFG) input; just a minor error check
             } else if(n->pinned()) {
@@ -288,10 +296,10 @@ namespace gcm {
     // find the best possible placement (ctrl) for every node (after finding the latest possible)
     // sets each data node's ctrl to be best found
     void schedule_late(NodeStop* stop) {
-        mem::Arena scratch = mem::Arena::create(10 MB);
-        u32 num_nodes = Node::uid_counter;
-        Node** late = scratch.alloc<Node*>(num_nodes); mem::zero(late, num_nodes);
-        Node** ns = scratch.alloc<Node*>(num_nodes); mem::zero(ns, num_nodes);
+        mem::Scratch scratch;
+        u32 num_nodes = Node::uid_counter + 1; // uids start at 1
+        Node** late = scratch.arena->alloc<Node*>(num_nodes); mem::zero(late, num_nodes);
+        Node** ns = scratch.arena->alloc<Node*>(num_nodes); mem::zero(ns, num_nodes);
         gcm::walk_breadth((Node*) stop, ns, late); // find best cfg block
         // Copy the best placement choice into the ctrl slot
         for(u32 i = 0; i < num_nodes; i++) {
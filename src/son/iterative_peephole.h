@@ -0,0 +1,140 @@
+#pragma once
+
+#include "node.h"
+
+// Iterative peepholes
+// `node::peephole` only runs once, when a node is created; some opportunities only show up later (most notably after
+// loop phis get completed in `NodeScope::end_loop`). This pass keeps peepholing every live node until nothing changes.
+namespace peeps {
+    struct Stats {
+        u32 iterations; // number of nodes popped off the worklist
+        u32 rewrites; // number of nodes replaced, changed in place or removed
+    };
+
+    // worklist of unique nodes; `on` is indexed by uid
+    struct Worklist {
+        Vec<Node*> nodes;
+        BitSet on;
+
+        void push(Node* n) {
+            if(n == nullptr || on[n->uid]) return;
+            on.set(n->uid);
+            nodes.push(n);
+        }
+        void push_all(Edges& ns) {
+            for(Node* n : ns) this->push(n);
+        }
+        Node* pop() {
+            Node* n = nodes.pop();
+            on.unset(n->uid);
+            return n;
+        }
+        bool empty() { return nodes.empty(); }
+    };
+
+    // push everything reachable from `start` through outputs, in depth first preorder
+    // iterative, since the graph can get deep
+    void seed(Node* start, Worklist& work, mem::Arena& scratch) {
+        struct Frame {
+            Node* n;
+            u32 next; // index of the next output to visit
+        };
+        Vec<Frame> stack = Vec<Frame>::create(scratch);
+        BitSet visit = BitSet::create(Node::uid_counter + 1, scratch);
+        visit.set(start->uid);
+        work.push(start);
+        stack.push(Frame { .n = start, .next = 0 });
+        while(!stack.empty()) {
+            Frame& f = stack.back();
+            if(f.next == f.n->output.size) { stack.pop(); continue; }
+            Node* out = f.n->output[f.next++];
+            if(visit[out->uid]) continue;
+            visit.set(out->uid);
+            work.push(out);
+            stack.push(Frame { .n = out, .next = 0 });
+        }
+    }
+
+    // the users of `n` and whatever looked into `n` while idealizing should be looked at again
+    void push_users(Node* n, Worklist& work) {
+        work.push_all(n->output);
+        if(n->deps == nullptr) return;
+        work.push_all(*n->deps);
+        n->deps->clear();
+    }
+
+    // replace `n` with `other` everywhere
+    void replace(Node* n, Node* other, Worklist& work) {
+        peeps::push_users(n, work);
+        work.push(other);
+        n->subsume(other);
+    }
+
+    // return true if `n` was rewritten
+    bool step(Node* n, Worklist& work) {
+        if(n->type == nullptr) return false; // already dead
+        if(n->nt == NodeType::Scope) return false; // scopes are not a part of the program
+        if(n->is_unused() && !n->cfg()) {
+            // dead data node that just hasn't been cleaned up; its inputs may die with it
+            for(Node* in : n->input) work.push(in);
+            n->kill();
+            return true;
+        }
+
+        Type* t = node::compute(n);
+        if(t != n->type) {
+            n->type = t;
+            peeps::push_users(n, work);
+        }
+
+        u32 last_uid = Node::uid_counter;
+        Node* idealized = node::idealize(n);
+        if(idealized == n) {
+            // changed its own inputs
+            work.push(n);
+            peeps::push_users(n, work);
+            return true;
+        }
+        if(idealized != nullptr) {
+            if(n->keepalive) {
+                // can't get rid of `n`; drop the replacement if it was made just now
+                if(idealized->uid > last_uid && idealized->is_unused()) idealized->kill();
+                return false;
+            }
+            peeps::replace(n, idealized, work);
+            return true;
+        }
+
+        // same as `node::value_number`, but the graph is already built, so `n` gets replaced instead
+        if(node::gvn_eligible(n) && !n->keepalive) {
+            Node* found = n->lock();
+            if(found != n) {
+                peeps::replace(n, found, work);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // peephole every node reachable from `start` until a fixpoint
+    Stats run(Node* start) {
+        Stats stats {};
+        #ifdef NOOPTS
+        return stats;
+        #endif
+        mem::Scratch scratch;
+        Worklist work { .nodes = Vec<Node*>::create(*scratch.arena), .on = BitSet::create(Node::uid_counter + 1, *scratch.arena) };
+        peeps::seed(start, work, *scratch.arena);
+        while(!work.empty()) {
+            Node* n = work.pop();
+            stats.iterations++;
+            if(peeps::step(n, work)) stats.rewrites++;
+        }
+        return stats;
+    }
+
+    // in the namespace, so `profile::note` finds it
+    std::ostream& operator<<(std::ostream& os, Stats const& stats) {
+        return os << stats.iterations << " iterations, " << stats.rewrites << " rewrites";
+    }
+}
@@ -5,6 +5,7 @@
 #include "node/node.h"
 
 #include "node/eq.h"
+#include "node/hash.h"
 #include "node/cfg.h"
 #include "node/glb.h"
 #include "node/ctrl.h"
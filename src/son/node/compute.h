@@ -46,9 +46,9 @@ namespace node {
                     // return node::glb(node->data(0)->type);
                     Type* t = node->data(0)->type;
                     if(t->ttype == TypeT::Mem) {
-                        TypePtr* memtype = (TypePtr*) type::pool.get_bottom(TypeT::Mem);
-                        memtype->ptr = type::pool.get_bottom(((TypePtr*) t)->ptr->ttype);
-                        return (Type*) memtype;
+                        // pooled types are shared, so this has to be a new one rather than an edited bottom
+                        Type* ptr = type::pool.get_bottom(((TypePtr*) t)->ptr->ttype);
+                        return type::pool.get_ptr(TypePtr { .self = { .tinfo = TypeI::Bottom, .ttype = TypeT::Mem }, .ptr = ptr });
                     }
                     return type::pool.get_bottom(t->ttype);
                 }
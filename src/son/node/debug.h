@@ -154,9 +154,9 @@ namespace node {
         }
     }
     void print_tree(Node* root) {
-        mem::Arena scratch = mem::Arena::create(1 MB);
+        mem::Scratch scratch;
         u32 size = Node::uid_counter + 1;
-        bool* arr = scratch.alloc<bool>(size);
+        bool* arr = scratch.arena->alloc<bool>(size);
         std::fill(arr, arr + size, false);
         node::print_tree(root, arr);
     }
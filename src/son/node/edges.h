@@ -0,0 +1,123 @@
+#pragma once
+
+#include "../prelude.h"
+
+struct Node;
+
+// Use-def or def-use edges of a node
+// Similar to `Vec<Node*>`, but half the size: it's always on the node arena, so it doesn't need its own arena pointer,
+// and size and capacity are 32 bits. `Node::place` points `input` at room allocated right after the node.
+//
+// Every edge also has a back-index, so it can be removed from either end in O(1) (see `Node::add_use` and `Node::remove_use`):
+//  for `input`, `back(i)` is the position of the user in `input[i]->output`
+//  for `output`, `back(p)` is the index of the def in `output[p]->input`
+// back-indices are stored in the same allocation, right after the `capacity` pointers
+struct Edges {
+    Node** data; // nullable
+    u32 size;
+    u32 capacity;
+
+    inline static thread_local mem::Arena* arena = nullptr; // set by `Node::init`
+
+    static constexpr u32 NO_BACK = U32_MAX; // the edge is not recorded on the other end (x86 nodes are linked manually)
+
+    // number of pointer sized words needed to hold `capacity` edges with their back-indices
+    static usize words(u32 capacity) {
+        return capacity + ceil_div(capacity * sizeof(u32), sizeof(Node*));
+    }
+
+    void reserve(u32 new_capacity) {
+        if(new_capacity <= capacity) return;
+        Node** new_data = (Node**) Edges::arena->recycle(Edges::words(new_capacity) * sizeof(Node*), alignof(Node*));
+        if(new_data == nullptr) new_data = Edges::arena->alloc<Node*>(Edges::words(new_capacity));
+        u32* new_back = (u32*) (new_data + new_capacity);
+        if(size > 0) {
+            mem::copy(new_data, data, size);
+            mem::copy(new_back, &this->back(0), size);
+        }
+        Edges::arena->release(data, Edges::words(capacity) * sizeof(Node*));
+        data = new_data;
+        capacity = new_capacity;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    void push(Node* n, u32 back = NO_BACK) {
+        if(size == capacity) this->reserve(capacity == 0 ? 4 : capacity * 2);
+        data[size] = n;
+        this->back(size) = back;
+        size++;
+    }
+
+    Node* pop() {
+        assert(size > 0);
+        size--;
+        return data[size];
+    }
+
+    void clear() {
+        size = 0;
+    }
+
+    /* Access Member Functions */
+
+    Node* const& operator[](u32 i) const {
+        assert(i < size);
+        return data[i];
+    }
+
+    Node*& operator[](u32 i) {
+        assert(i < size);
+        return data[i];
+    }
+
+    u32& back(u32 i) {
+        assert(i < capacity);
+        return ((u32*) (data + capacity))[i];
+    }
+
+    /* Util functions */
+
+    // Remove an element at a given index, shifting the rest (and their back-indices) down
+    void remove(u32 remove_index) {
+        assert(remove_index < size);
+        size--;
+        for(u32 i = remove_index; i < size; i++) {
+            data[i] = data[i+1];
+            this->back(i) = this->back(i+1);
+        }
+    }
+
+    // Return the index of the first occurance of `n` or `size` if not found
+    u32 index_of(Node* n) const {
+        for(u32 i = 0; i < size; i++) {
+            if(data[i] == n) return i;
+        }
+        return size;
+    }
+
+    bool contains(Node* n) const {
+        return this->index_of(n) != size;
+    }
+
+    /* Slice compatibility */
+
+    Slice<Node*> full_slice() {
+        return Slice<Node*> { .data = data, .size = size };
+    }
+
+    bool operator==(Edges const& other) const {
+        if(size != other.size) return false;
+        for(u32 i = 0; i < size; i++) {
+            if(data[i] != other.data[i]) return false;
+        }
+        return true;
+    }
+
+    /* STL Compatibility */
+
+    Node** begin() { return data; }
+    Node** end() { return data + size; }
+};
@@ -17,10 +17,13 @@ namespace node {
             case NodeType::Phi:
             case NodeType::Load:
             case NodeType::Store:
-            case NodeType::AllocA:
+            case NodeType::AllocA: {
+                return left->input == right->input;
+            }
+
             case NodeType::BinOp:
             case NodeType::UnOp: {
-                return left->input == right->input;
+                return left->input == right->input && left->op() == right->op();
             }
             
             case NodeType::CtrlProj:
@@ -4,58 +4,101 @@
 
 struct Node;
 namespace node {
+    u64 hash(Node*);
     bool eq(Node*, Node*);
 }
 
+// Global value numbering table
+// Open addressing (linear probing) on a power of two capacity, keyed by `node::hash` and compared with `node::eq`
+// Nodes in the table must not change their inputs, since that would change their hash; see `Node::lock` and `Node::unlock`
 struct GVN {
-    Vec<Node*> nodes;
-    Node* last_lookup;
-    u32 last_index;
+    struct Slot {
+        u64 hash; // cached `node::hash` of `n`; valid while `n` is locked
+        Node* n; // nullptr = empty; `GVN::TOMBSTONE` = removed
+    };
+
+    Slot* slots; // nullable, owned
+    u32 size; // number of live nodes
+    u32 used; // number of live nodes + tombstones
+    u32 capacity; // power of two (or 0)
+
+    mem::Arena* arena;
+
+    inline static Node* const TOMBSTONE = (Node*) 1;
 
     static GVN create(mem::Arena& arena = default_arena) {
-        return GVN {
-            .nodes = Vec<Node*>::create(arena),
-            .last_lookup = nullptr
-        };
+        GVN g {};
+        g.arena = &arena;
+        return g;
+    }
+
+    u32 home(u64 hash) const {
+        return (u32) hash & (capacity - 1);
     }
 
-    u32 index_of(Node* n) {
-        if(last_lookup == n) return last_index;
-        for(u32 i = 0; i < nodes.size; i++) {
-            if(node::eq(nodes[i], n)) return i;
+    // return the slot holding a node equal to `n`, or nullptr if there's none
+    Slot* find(Node* n, u64 hash) {
+        if(capacity == 0) return nullptr;
+        for(u32 i = this->home(hash);; i = (i + 1) & (capacity - 1)) {
+            Slot& s = slots[i];
+            if(s.n == nullptr) return nullptr;
+            if(s.n != TOMBSTONE && s.hash == hash && (s.n == n || node::eq(s.n, n))) return &s;
         }
-        panic;
     }
 
-    bool has(Node* n) {
-        for(u32 i = 0; i < nodes.size; i++) {
-            if(node::eq(nodes[i], n)) {
-                last_lookup = n; last_index = i;
-                return true;
-            }
+    void place(Node* n, u64 hash) {
+        u32 i = this->home(hash);
+        while(slots[i].n != nullptr && slots[i].n != TOMBSTONE) i = (i + 1) & (capacity - 1);
+        if(slots[i].n == nullptr) used++;
+        slots[i] = Slot { .hash = hash, .n = n };
+        size++;
+    }
+
+    // rebuild the table, dropping tombstones; grow if mostly live nodes
+    void rehash() {
+        if(arena == nullptr) arena = &default_arena;
+        Slot* old = slots;
+        u32 old_capacity = capacity;
+        if(capacity == 0) capacity = 64;
+        else if(size * 2 >= capacity) capacity *= 2;
+        slots = arena->alloc<Slot>(capacity);
+        mem::zero(slots, capacity);
+        size = 0; used = 0;
+        for(u32 i = 0; i < old_capacity; i++) {
+            if(old[i].n != nullptr && old[i].n != TOMBSTONE) this->place(old[i].n, old[i].hash);
         }
-        last_lookup = nullptr;
-        return false;
+    }
+
+    bool has(Node* n) {
+        return this->find(n, node::hash(n)) != nullptr;
+    }
+
+    // return the node equal to `n` that is already in the table; if there's none, insert `n` and return it
+    Node* get(Node* n) {
+        u64 hash = node::hash(n);
+        Slot* s = this->find(n, hash);
+        if(s != nullptr) return s->n;
+        if((used + 1) * 4 > capacity * 3) this->rehash(); // keep load (including tombstones) under 3/4
+        this->place(n, hash);
+        return n;
     }
 
     void insert(Node* n) {
-        if(!this->has(n)) nodes.push(n);
+        this->get(n);
     }
 
     // returned the removed node; SHOULDN'T BE RELIED ON, ONLY USE FOR ASSERTS
     Node* remove(Node* n) {
-        if(this->has(n)) {
-            u32 i = this->index_of(n);
-            Node* to_remove = nodes[i];
-            nodes.remove(i);
-            return to_remove;
-        }
-        return nullptr;
+        Slot* s = this->find(n, node::hash(n));
+        if(s == nullptr) return nullptr;
+        Node* removed = s->n;
+        s->n = TOMBSTONE;
+        size--;
+        return removed;
     }
 
-    Node* get(Node* n) {
-        if(this->has(n)) return nodes[this->index_of(n)];
-        insert(n);
-        return n;
+    void clear() {
+        if(slots != nullptr) mem::zero(slots, capacity);
+        size = 0; used = 0;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "node.h"
+
+namespace node {
+    // must agree with `node::eq`: if `eq(a,b)` then `hash(a) == hash(b)`
+    // inputs are hashed by `uid`, so the hash is only stable while the inputs of `n` don't change (see `Node::lock`)
+    u64 hash(Node* n) {
+        assert(n != nullptr);
+        u64 h = hash::from(n->nt);
+        switch(n->nt) {
+            case NodeType::Const: {
+                // `node::eq` doesn't look at the inputs of constants; types are interned, so the pointer is the identity
+                NodeConst* node = (NodeConst*) n;
+                return hash::combine(h, hash::from(node->val));
+            }
+
+            case NodeType::CtrlProj:
+            case NodeType::Proj: {
+                NodeProj* node = (NodeProj*) n;
+                h = hash::combine(h, hash::from(node->index));
+                break;
+            }
+
+            case NodeType::BinOp:
+            case NodeType::UnOp: {
+                h = hash::combine(h, hash::from(n->op()));
+                break;
+            }
+
+            default: break;
+        }
+        for(u32 i = 0; i < n->input.size; i++) {
+            Node* in = n->input[i];
+            h = hash::combine(h, in == nullptr ? 0 : in->uid);
+        }
+        return h;
+    }
+
+    // nodes that are pure functions of their inputs can be shared through global value numbering
+    bool gvn_eligible(Node* n) {
+        switch(n->nt) {
+            case NodeType::Const:
+            case NodeType::BinOp:
+            case NodeType::UnOp:
+            case NodeType::Proj:
+                return true;
+            default:
+                return false;
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../../core/profile.h"
+
 #include "node.h"
 
 namespace node {
@@ -30,7 +32,7 @@ namespace node {
     // Nullable; When nullptr is returned, no progress/change has been made
     Node* idealize(Node* n) {
         Node* const_replace = node::replace_with_const(n);
-        if(const_replace != nullptr) return const_replace;
+        if(const_replace != nullptr) return profile::rule("constant -> Const"_s, const_replace);
         
         switch(n->nt) {
             case NodeType::Scope: // shouldn't even be idealized
@@ -57,21 +59,23 @@ namespace node {
                 ) { return nullptr; } // self of region is incomplete; don't optimize yet
 
                 Node* maybe_single = node->single_unique_input();
-                if(maybe_single != nullptr) { return maybe_single; }
+                if(maybe_single != nullptr) { return profile::rule("phi: single input"_s, maybe_single); }
 
                 // Pull "down" a common data op. One less op in the world. One more Phi, but Phis do not make code.
                 // `Phi(op(A,B),op(Q,R),op(X,Y))` becomes `op(Phi(A,Q,X), Phi(B,R,Y))`
-                if(node->data(0)->nt == NodeType::BinOp && node->all_same()) {
-                    mem::Arena arena = mem::Arena::create(5 MB);
-                    Vec<Node*> lhs_data = Vec<Node*>::create(arena);
-                    Vec<Node*> rhs_data = Vec<Node*>::create(arena);
+                // looks at the data inputs' inputs, so revisit this phi if any of them changes
+                for(u32 i = 0; i < node->data_size(); i++) node->data(i)->add_dep(n);
+                if(node->data(0)->nt == NodeType::BinOp && node->all_same() && node->all_same_op()) {
+                    mem::Scratch scratch;
+                    Vec<Node*> lhs_data = Vec<Node*>::create(*scratch.arena);
+                    Vec<Node*> rhs_data = Vec<Node*>::create(*scratch.arena);
                     for(u32 i = 0; i < node->data_size(); i++) {
                         lhs_data.push(ref(((NodeBinOp*)node->data(i))->lhs()));
                         rhs_data.push(ref(((NodeBinOp*)node->data(i))->rhs()));
                     }
-                    Node* phi_lhs = NodePhi::create(node->debug_var_name, node->region(), lhs_data.full_slice());
-                    Node* phi_rhs = NodePhi::create(node->debug_var_name, node->region(), rhs_data.full_slice());
-                    return NodeBinOp::create(((NodeBinOp*) node->data(0))->op, phi_lhs, phi_rhs);
+                    Node* phi_lhs = NodePhi::create(node->debug_var, node->region(), lhs_data.full_slice());
+                    Node* phi_rhs = NodePhi::create(node->debug_var, node->region(), rhs_data.full_slice());
+                    return profile::rule("phi: pull down op"_s, NodeBinOp::create(((NodeBinOp*) node->data(0))->op, phi_lhs, phi_rhs));
                 }
 
                 return nullptr;
@@ -122,11 +126,11 @@ namespace node {
         Op lop = lhs->nt == NodeType::BinOp ? ((NodeBinOp*)lhs)->op : Op::Undefined;
         Op rop = rhs->nt == NodeType::BinOp ? ((NodeBinOp*)rhs)->op : Op::Undefined;
         // Add of 0. If (0+x), will be canonicalized to (x+0).
-        if(rhs->type == type::pool.con(0)) return lhs;
+        if(rhs->type == type::pool.con(0)) return profile::rule("add: x+0"_s, lhs);
 
         // Add of same is a multiply by 2
         if(lhs == rhs) {
-            return NodeBinOp::create(Op::Mul, lhs, NodeConst::create(2));
+            return profile::rule("add: x+x -> x*2"_s, NodeBinOp::create(Op::Mul, lhs, NodeConst::create(2)));
         }
 
         // Move ops such that: adds are on the left, consts are on the right
@@ -134,7 +138,7 @@ namespace node {
         // Move non-adds to RHS
         if(lop != Op::Add && rop == Op::Add) {
             node->swap_lhs_rhs();
-            return (Node*)node;
+            return profile::rule("add: adds to the left"_s, (Node*)node);
         }
 
         // Note: for the following notation (add add non) since they've been rotated, it's assumed to be ((add add) non) which is implicitly ((add + add) + non)
@@ -146,14 +150,14 @@ namespace node {
         if(rop == Op::Add) {
             NodeBinOp* rhs_add = (NodeBinOp*) rhs;
             Node* new_lhs = NodeBinOp::create(Op::Add, lhs, rhs_add->lhs());
-            return NodeBinOp::create(Op::Add, new_lhs, rhs_add->rhs());
+            return profile::rule("add: x+(y+z) -> (x+y)+z"_s, NodeBinOp::create(Op::Add, new_lhs, rhs_add->rhs()));
         }
 
         // Now we might see (add add non) or (add non non) but never (add non add) nor (add add add)
         if(lop != Op::Add) {
             if(should_swap(node->lhs(), node->rhs())) {
                 node->swap_lhs_rhs();
-                return (Node*)node;
+                return profile::rule("add: canonical order"_s, (Node*)node);
             }
             return nullptr;
         }
@@ -163,10 +167,11 @@ namespace node {
         // Do we have (x + con1) + con2?
         // Replace with (x + (con1+con2) which then fold the constants
         NodeBinOp* lhs_add = (NodeBinOp*) lhs;
+        lhs->add_dep((Node*)node); // the rules below look at the inputs of `lhs`
         if(lhs_add->rhs()->nt == NodeType::Const && rhs->nt == NodeType::Const) {
             Node* new_lhs = lhs_add->lhs();
             Node* new_rhs = NodeBinOp::create(Op::Add, lhs_add->rhs(), node->rhs());
-            return NodeBinOp::create(Op::Add, new_lhs, new_rhs);
+            return profile::rule("add: (x+c1)+c2 -> x+(c1+c2)"_s, NodeBinOp::create(Op::Add, new_lhs, new_rhs));
         }
 
         // Now we sort along the spline via rotates, to gather similar things together.
@@ -176,7 +181,7 @@ namespace node {
         if(should_swap(lhs_add->rhs(), node->rhs())) {
             Node* new_lhs = NodeBinOp::create(Op::Add, lhs_add->lhs(), node->rhs());
             Node* new_rhs = lhs_add->rhs();
-            return NodeBinOp::create(Op::Add, new_lhs, new_rhs);
+            return profile::rule("add: (x+y)+z -> (x+z)+y"_s, NodeBinOp::create(Op::Add, new_lhs, new_rhs));
         }
 
         return nullptr;
@@ -186,10 +191,10 @@ namespace node {
         Node* lhs = node->lhs();
         Node* rhs = node->rhs();
         // Subtract 0 identity
-        if(rhs->type == type::pool.con(0)) return lhs;
+        if(rhs->type == type::pool.con(0)) return profile::rule("sub: x-0"_s, lhs);
 
         // Negation identity
-        if(lhs->type == type::pool.con(0)) return NodeUnOp::create(Op::Neg, rhs);
+        if(lhs->type == type::pool.con(0)) return profile::rule("sub: 0-x -> -x"_s, NodeUnOp::create(Op::Neg, rhs));
 
         return nullptr;
     }
@@ -200,15 +205,16 @@ namespace node {
         Op lop = lhs->nt == NodeType::BinOp ? ((NodeBinOp*)lhs)->op : Op::Undefined;
         // Op rop = rhs->nt == NodeType::BinOp ? ((NodeBinOp*)rhs)->op : Op::Undefined;
         // Multiply by 1 identity
-        if(rhs->type == type::pool.con(1)) return lhs;
+        if(rhs->type == type::pool.con(1)) return profile::rule("mul: x*1"_s, lhs);
 
         // Canonicalize to constants being on the right
         if(lhs->nt == NodeType::Const && rhs->nt != NodeType::Const) {
             node->swap_lhs_rhs();
-            return (Node*)node;
+            return profile::rule("mul: constant to the right"_s, (Node*)node);
         }
 
         // convert (arg * 2) * 3 into arg * 6
+        if(lop == Op::Mul) lhs->add_dep((Node*)node);
         if(lop == Op::Mul && (
             rhs->nt == NodeType::Const &&
             ((NodeBinOp*)lhs)->rhs()->nt == NodeType::Const
@@ -218,7 +224,7 @@ namespace node {
             Node* new_lhs = ((NodeBinOp*)lhs)->lhs();
             Node* mul = NodeBinOp::create(Op::Mul, i1, i2);
             Node* self = NodeBinOp::create(Op::Mul, new_lhs, mul);
-            return self;
+            return profile::rule("mul: (x*c1)*c2 -> x*(c1*c2)"_s, self);
         }
 
         return nullptr;
@@ -228,7 +234,7 @@ namespace node {
         Node* lhs = node->lhs();
         Node* rhs = node->rhs();
         // Divide by 1 identity
-        if(rhs->type == type::pool.con(1)) return lhs;
+        if(rhs->type == type::pool.con(1)) return profile::rule("div: x/1"_s, lhs);
 
         return nullptr;
     }
@@ -237,7 +243,7 @@ namespace node {
         // Node* lhs = node->lhs();
         Node* rhs = node->rhs();
         // Modulo 1 identity
-        if(rhs->type == type::pool.con(1)) return NodeConst::create((i64)0); // c++, 0 is not a pointer, it's a number you dum dum
+        if(rhs->type == type::pool.con(1)) return profile::rule("mod: x%1 -> 0"_s, NodeConst::create((i64)0)); // c++, 0 is not a pointer, it's a number you dum dum
 
         return nullptr;
     }
@@ -23,7 +23,7 @@ struct NodeStart {
             .self = Node::create(NodeType::Start),
             .args = (TypeTuple*) type::pool.from_slice(args)
         };
-        return node::peephole((Node*) Node::node_arena->push(node));
+        return node::peephole((Node*) Node::place(node));
     }
 
     // Getters
@@ -38,7 +38,7 @@ struct NodeStop {
         NodeStop node = NodeStop { 
             .self = Node::create(NodeType::Stop)
         };
-        return node::peephole((Node*) Node::node_arena->push(node));
+        return node::peephole((Node*) Node::place(node));
     }
 
     CFGNode* ctrl(u32 index) {
@@ -56,7 +56,7 @@ struct NodeRet {
     // Constructors
     static Node* create(CFGNode* ctrl, Node* data) {
         NodeRet node = { .self = Node::create(NodeType::Ret) };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl, data);
         return node::peephole(ptr);
     }
@@ -77,7 +77,7 @@ struct NodeIf {
         NodeIf node = { 
             .self = Node::create(NodeType::If)
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl, condition);
         return node::peephole(ptr);
     }
@@ -101,7 +101,7 @@ struct NodeRegion {
         NodeRegion node = { 
             .self = Node::create(NodeType::Region)
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl1, ctrl2);
         return node::peephole(ptr);
     }
@@ -111,7 +111,7 @@ struct NodeRegion {
         NodeRegion node = { 
             .self = Node::create(NodeType::Loop)
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl1, nullptr);
         return node::peephole(ptr);
     }
@@ -152,7 +152,7 @@ struct NodeProj {
             .self = Node::create(is_cfg ? NodeType::CtrlProj : NodeType::Proj),
             .index = tuple_index
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl);
         return node::peephole(ptr);
     }
@@ -185,7 +185,7 @@ struct NodeConst {
             .self = Node::create(NodeType::Const),
             .val = value
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(START_NODE);
         return node::peephole(ptr);
     }
@@ -207,7 +207,7 @@ struct NodeBinOp {
             .self = Node::create(NodeType::BinOp),
             .op = op
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(nullptr, lhs, rhs);
         return node::peephole(ptr);
     }
@@ -222,9 +222,7 @@ struct NodeBinOp {
 
     // Methods
     void swap_lhs_rhs() {
-        Node* temp = self.input[1];
-        self.input[1] = self.input[2];
-        self.input[2] = temp;
+        self.swap_inputs(1, 2);
     }
 };
 
@@ -240,7 +238,7 @@ struct NodeUnOp {
             .self = Node::create(NodeType::UnOp),
             .op = op
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(nullptr, rhs);
         return node::peephole(ptr);
     }
@@ -256,40 +254,40 @@ struct NodeUnOp {
 struct NodePhi {
     // self.input = [region(ctrl), input1, input2, ...]
     Node self;
-    Str debug_var_name;
+    Sym debug_var; // the variable this phi merges; only used for printing (see `sym::name`)
 
     // Constructors
     // TODO make vararg
-    static Node* create(Str debug_var_name, Node* ctrl, Node* data1, Node* data2) {
+    static Node* create(Sym debug_var, Node* ctrl, Node* data1, Node* data2) {
         assert(ctrl != nullptr);
         NodePhi node = { 
             .self = Node::create(NodeType::Phi),
-            .debug_var_name = debug_var_name
+            .debug_var = debug_var
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl, data1, data2);
         return node::peephole(ptr);
     }
-    static Node* create(Str debug_var_name, Node* ctrl, Slice<Node*> data_list) {
+    static Node* create(Sym debug_var, Node* ctrl, Slice<Node*> data_list) {
         assert(ctrl != nullptr);
         NodePhi node = { 
             .self = Node::create(NodeType::Phi),
-            .debug_var_name = debug_var_name
+            .debug_var = debug_var
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl);
         for(u32 i = 0; i < data_list.size; i++) {
             ptr->push_input(data_list[i]);
         }
         return node::peephole(ptr);
     }
-    static Node* create_incomplete(Str debug_var_name, Node* ctrl, Node* data1) {
+    static Node* create_incomplete(Sym debug_var, Node* ctrl, Node* data1) {
         assert(ctrl != nullptr);
         NodePhi node = { 
             .self = Node::create(NodeType::Phi),
-            .debug_var_name = debug_var_name
+            .debug_var = debug_var
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl, data1, nullptr);
         return node::peephole(ptr);
     }
@@ -321,6 +319,14 @@ struct NodePhi {
         }
         return true;
     }
+    // assuming `all_same()` and that the data inputs are BinOps, return true if they all have the same op
+    bool all_same_op() {
+        Op op = this->data(0)->op();
+        for(u32 i = 1; i < this->data_size(); i++) {
+            if(this->data(i)->op() != op) return false;
+        }
+        return true;
+    }
     // if all data inputs are the same, return the unique input; nullptr otherwise
     Node* single_unique_input() {
         // TODO if region has dead control, delete
@@ -348,7 +354,7 @@ struct NodeLoad {
             .mem_alias = alias,
             .decl_type = type::pool.int_sized(4) // TODO hardcoded
         };
-        Node* nptr = (Node*) Node::node_arena->push(node);
+        Node* nptr = (Node*) Node::place(node);
         nptr->push_inputs(nullptr, mem, ptr, offset);
         return node::peephole(nptr);
     }
@@ -371,7 +377,7 @@ struct NodeStore {
             .mem_alias = alias,
             .decl_type = type::pool.int_sized(4) // TODO hardcoded
         };
-        Node* nptr = (Node*) Node::node_arena->push(node);
+        Node* nptr = (Node*) Node::place(node);
         nptr->push_inputs(nullptr, mem, ptr, offset, val);
         return node::peephole(nptr);
     }
@@ -394,7 +400,7 @@ struct NodeAllocA {
             .self = Node::create(NodeType::AllocA),
             .ptr = (TypePtr*) decl_type
         };
-        Node* ptr = (Node*) Node::node_arena->push(node);
+        Node* ptr = (Node*) Node::place(node);
         ptr->push_inputs(ctrl, alloc_size, init_mem);
         return node::peephole(ptr);
     }
@@ -408,12 +414,12 @@ struct NodeScope {
     // self.input = [ctrl, ...]
     // note, self.input[i>0] can be NodeScope*; in that case it's a "sentinel"; read `# Explain` in README.md
     Node self;
-    VariableScope<usize> scope; // holds var_name -> index in self.input
+    VariableScope scope; // holds var_name -> index in self.input
 
     // Constructors
     static NodeScope* create(mem::Arena& arena, Node* ctrl) {
-        NodeScope node = NodeScope { .self = Node::create(NodeType::Scope), .scope = VariableScope<usize>::create(arena) };
-        NodeScope* ptr = Node::node_arena->push(node);
+        NodeScope node = NodeScope { .self = Node::create(NodeType::Scope), .scope = VariableScope::create(arena) };
+        NodeScope* ptr = Node::place(node);
         ptr->self.type = type::pool.ctrl; // maybe has to be Pure:Bottom?
         ptr->define(CTRL_STR, ctrl);
         return ptr;
@@ -422,7 +428,7 @@ struct NodeScope {
     // dead scope's ctrl is self
     static NodeScope* create_xctrl() {
         NodeScope node = NodeScope { .self = Node::create(NodeType::Scope) };
-        NodeScope* ptr = Node::node_arena->push(node);
+        NodeScope* ptr = Node::place(node);
         ptr->self.type = type::pool.xctrl;
         return ptr;
     }
@@ -434,7 +440,7 @@ struct NodeScope {
     // Methods
     NodeScope* duplicate() {
         if(this->is_xctrl()) { return NodeScope::create_xctrl(); }
-        NodeScope* dup = NodeScope::create(*scope.scopes.arena, this->ctrl());
+        NodeScope* dup = NodeScope::create(*scope.log.arena, this->ctrl());
         // Our goals are:  1) duplicate the name bindings of the ScopeNode across all stack levels  2) Make the new ScopeNode a user of all the nodes bound  3) Ensure that the order of defs is the same to allow easy merging
         dup->scope = scope.deep_clone();
         for(u32 i = 1; i < self.input.size; i++) {
@@ -445,7 +451,7 @@ struct NodeScope {
     // the duplocated NodeScope will have all of the bindings pointing to a different scope that has the actual value
     NodeScope* duplicate_with_sentinel() {
         if(this->is_xctrl()) { return NodeScope::create_xctrl(); }
-        NodeScope* dup = NodeScope::create(*scope.scopes.arena, this->ctrl());
+        NodeScope* dup = NodeScope::create(*scope.log.arena, this->ctrl());
         dup->scope = scope.deep_clone();
         for(u32 i = 1; i < self.input.size; i++) {
             dup->self.push_input((Node*)this);
@@ -461,6 +467,7 @@ struct NodeScope {
         if(this->is_xctrl()) {
             self.kill();
             *this = *other;
+            self.relink();
             *other = { 0 };
             return;
         }
@@ -473,7 +480,7 @@ struct NodeScope {
             if(self.input[i] != other->self.input[i]) {
                 Node* data1 = this->resolve_sentinel(i);
                 Node* data2 = other->resolve_sentinel(i);
-                self.set_input(i, NodePhi::create(scope.key_of(i), region, data1, data2));
+                self.set_input(i, NodePhi::create(this->key_of(i), region, data1, data2));
             }
         }
         ((Node*)other)->kill();
@@ -484,32 +491,38 @@ struct NodeScope {
     void pop() { if(this->is_xctrl()) { return; } self.pop_inputs(scope.top_size()); scope.pop(); }
 
     // If doesn't exist, return nullptr
-    Node* find(Str var_name) {
+    Node* find(Sym var_name) {
         if(this->is_xctrl()) { return VOID_NODE; }
-        if(!scope.contains(var_name)) return nullptr;
-        u32 index = (u32) scope[var_name];
+        u32 index = scope[var_name];
+        if(index == VariableScope::NONE) return nullptr;
         // if a sentinel, resolve it
         // A lazy phi needs to be created on first lookup; explained in README.md `# Explain`
         Node* val = this->resolve_sentinel(index);
         return val;
     }
-    Node* update(Str var_name, Node* new_value) {
+    Node* update(Sym var_name, Node* new_value) {
         if(this->is_xctrl()) { return VOID_NODE; }
-        assert(var_name != CTRL_STR);
-        if(!scope.contains(var_name)) { return nullptr; }
-        usize var_index = scope[var_name];
-        // Node* _node = this->resolve_sentinel(var_index); // TODO not necessary; delete
+        assert(sym::name(var_name) != CTRL_STR);
+        u32 var_index = scope[var_name];
+        if(var_index == VariableScope::NONE) { return nullptr; }
+        // a loop needs a phi for anything assigned in it, even if it's never read there
+        this->resolve_sentinel(var_index);
         self.set_input(var_index, new_value);
         return new_value;
     }
     // TODO if shadowing, remove the old value I think
-    Node* define(Str var_name, Node* new_value) {
+    Node* define(Sym var_name, Node* new_value) {
         if(this->is_xctrl()) { return VOID_NODE; }
         // no need to `resolve_sentinel` since can only define or redefine in the top scope = cannot encounter a sentinel
         scope.define(var_name, self.input.size);
         self.push_input(new_value);
         return new_value;
     }
+    Node* find(Str var_name) { return this->find(sym::intern(var_name)); }
+    Node* update(Str var_name, Node* new_value) { return this->update(sym::intern(var_name), new_value); }
+    Node* define(Str var_name, Node* new_value) { return this->define(sym::intern(var_name), new_value); }
+    // the variable in the given slot; used to name phis
+    Sym key_of(u32 i) { return scope.key_of(i); }
     void update_ctrl(Node* new_ctrl) {
         if(this->is_xctrl()) { return; }
         self.set_input(0, new_ctrl);
@@ -529,7 +542,7 @@ struct NodeScope {
             phi = sentinel->self.input[i];
         } else {
             // create lazy phi
-            phi = NodePhi::create_incomplete(scope.key_of(i), sentinel->ctrl(), sentinel->resolve_sentinel(i));
+            phi = NodePhi::create_incomplete(this->key_of(i), sentinel->ctrl(), sentinel->resolve_sentinel(i));
             sentinel->self.set_input(i, phi);
         }
         self.set_input(i, phi);
@@ -550,10 +563,10 @@ struct NodeScope {
         cur_ctrl->complete(back->ctrl());
         for(u32 i = 1; i < self.input.size; i++) {
             if(back->self.input[i] != (Node*)this) {
-                // will be a lazy phi OR something else if assigned but never accessed inside the loop
-                if(self.input[i]->nt == NodeType::Phi) {
-                    NodePhi* phi = (NodePhi*)self.input[i]; // technically might be unsafe, but should always be true
-                    assert(phi->region() == (Node*)cur_ctrl && phi->is_incomplete());
+                // a lazy phi of this loop, OR the value it came in with if the back edge is dead (an outer loop's phi, say)
+                if(self.input[i]->nt == NodeType::Phi && ((NodePhi*)self.input[i])->region() == (Node*)cur_ctrl) {
+                    NodePhi* phi = (NodePhi*)self.input[i];
+                    assert(phi->is_incomplete());
                     phi->complete(back->self.input[i]);
                 } else {
                     assert(back->self.input[i] != nullptr);
@@ -596,7 +609,7 @@ struct x86NodeOpR {
     static Node* create(Node* op) {
         assert(op->nt == NodeType::BinOp);
         x86NodeOpR self = { Node::create(node::x86_op_r(op->op())) };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->copy_inputs(op); // will copy [ctrl, lhs, rhs]
         nptr->type = op->type;
         return nptr;
@@ -616,7 +629,7 @@ struct x86NodeOpI {
         NodeBinOp* binop = (NodeBinOp*)op;
         assert(binop->rhs()->nt == NodeType::Const);
         x86NodeOpI self = { .self = Node::create(node::x86_op_i(binop->op)), .imm = ((TypeInt*)((NodeConst*)binop->rhs())->val)->val() };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->copy_inputs(op); // will copy [ctrl, lhs, rhs]
         nptr->pop_input(); // will pop rhs since it's a const that's been recorded as self.imm
         nptr->type = op->type;
@@ -640,7 +653,7 @@ struct x86NodeOpM {
         NodeBinOp* binop = (NodeBinOp*)op;
         assert(binop->rhs()->nt == NodeType::Const);
         x86NodeOpM self = { .self = Node::create(node::x86_op_m(binop->op)) };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->copy_inputs(op); // will copy [ctrl, lhs, rhs]
         nptr->pop_input(); // will pop rhs since it's a const that's been recorded as self.imm
         nptr->type = op->type;
@@ -659,11 +672,11 @@ struct x86NodeMov {
 
     // Constructors
     // move immidiate up to 64 bit
-    static Node* imm(NodeConst* imm) {
+    static Node* create_imm(NodeConst* imm) {
         assert(imm->self.nt == NodeType::Const);
         assert(imm->self.type->ttype == TypeT::Int);
         x86NodeMov self = { .self = Node::create(NodeType::x86MovI), .imm = ((TypeInt*)(imm)->val)->val() };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->copy_inputs((Node*)imm); // will copy [ctrl]
         nptr->type = imm->self.type;
         return nptr;
@@ -680,7 +693,7 @@ struct x86NodeJmp {
     static Node* create(NodeIf* n) {
         assert(n->self.nt == NodeType::If);
         x86NodeJmp self = { .self = Node::create(NodeType::x86Jump) };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->copy_inputs((Node*)n); // will copy [ctrl, cond]
         nptr->type = n->self.type;
         return nptr;
@@ -696,7 +709,7 @@ struct x86NodeSet {
     static Node* create(Node* cmp, NodeBinOp* op) {
         assert(cmp->nt == NodeType::x86CmpR || cmp->nt == NodeType::x86CmpI || cmp->nt == NodeType::x86CmpM);// || cmp->nt == NodeType::x86CmpMI);
         x86NodeSet self = { .self = Node::create(node::x86_set_op(op->op)) };
-        Node* nptr = (Node*) Node::node_arena->push(self);
+        Node* nptr = (Node*) Node::place(self);
         nptr->input.push(op->ctrl());
         nptr->input.push(cmp);
         nptr->type = cmp->type; // TODO maybe `op` instead?
@@ -11,6 +11,8 @@
 #include "../../token/tokenizer.h"
 
 #include "static.h"
+#include "gvn.h"
+#include "edges.h"
 
 struct Node;
 typedef Node CFGNode; // semantically must be a cfg node
@@ -32,7 +34,7 @@ namespace node {
     u32 mem_alias_of_load(Node* n);
 };
 
-enum class NodeType {
+enum class NodeType : u8 {
     Undefined = 0,
     Scope,
 
@@ -105,41 +107,49 @@ enum class NodeType {
     x86MovR,
     x86MovI,
 };
+namespace node {
+    u32 inline_inputs(NodeType nt);
+};
 
 // Assume that *every* node is reachable from Start by *only* using `output` edges and from Stop by *only* using `input` edges
+// Fields are ordered to pack into 64 bytes
 struct Node {
     u32 uid;
     NodeType nt;
-    Vec<Node*> input; // use-def references; nullable, fixed length, ordered; for data nodes, `input[0]` is always ctrl
-    Vec<Node*> output; // def-use references
-    Vec<Node*> deps; // dependents; when optimizing this node, the dependents should also be optimized (during the iterative peeps)
-    Type* type; // best known type of this node; if null, this node is dead (nonull for alive nodes)
     bool keepalive;
-    bool locked;
-
+    bool locked; // true when this node is in `Node::gvn`; its inputs must not change while locked
     u32 cfgid; // assigned and used during `compute_idom` step; only defined for cfg nodes; index into the `dom` and other vectors
+    Type* type; // best known type of this node; if null, this node is dead (nonull for alive nodes)
+    Edges input; // use-def references; nullable, fixed length, ordered; for data nodes, `input[0]` is always ctrl
+    Edges output; // def-use references
+    Edges* deps; // nullable; dependents; when optimizing this node, the dependents should also be optimized (during the iterative peeps)
 
-    inline static u32 uid_counter = 0;
-    inline static mem::Arena* node_arena = nullptr;
-    // inline static GVN gvn = {}; // global value numbering
+    inline static thread_local u32 uid_counter = 0;
+    inline static thread_local mem::Arena* node_arena = nullptr;
+    inline static thread_local GVN gvn = {}; // global value numbering
 
     // CALL AT THE BEGINNING OF MAIN
     static void init(mem::Arena& arena) {
         Node::uid_counter = 0;
         Node::node_arena = &arena;
-        // Node::gvn = GVN::create(arena);
+        Edges::arena = &arena;
+        Node::gvn = GVN::create(arena);
     }
 
     static Node create(NodeType type) {
         Node::uid_counter++;
-        return Node {
-            .uid=Node::uid_counter, .nt=type,
-            .input=Vec<Node*>::create(*Node::node_arena),
-            .output=Vec<Node*>::create(*Node::node_arena),
-            .deps=Vec<Node*>::create(*Node::node_arena),
-            .type=type::pool.top,
-            .keepalive=false, .locked=false
-        };
+        return Node { .uid=Node::uid_counter, .nt=type, .keepalive=false, .locked=false, .type=type::pool.top };
+    }
+
+    // put a concrete node (that starts with `Node self`) on the node arena, followed by room for its inputs, so the
+    // inputs share its cache lines; they are only moved out of line if there ends up being more than `node::inline_inputs`
+    template <typename N>
+    static N* place(N const& node) {
+        N* ptr = Node::node_arena->push(node);
+        Node* n = (Node*) ptr;
+        n->input.capacity = node::inline_inputs(n->nt);
+        n->input.data = Node::node_arena->alloc<Node*>(Edges::words(n->input.capacity));
+        return ptr;
     }
 
     /* Methods */
@@ -150,17 +160,17 @@ struct Node {
         (this->push_input(std::forward<Args>(inputs)), ...);
     }
     void push_input(Node* new_input) {
+        this->unlock();
         input.push(new_input);
-        if(new_input != nullptr) new_input->output.push(this);
+        this->add_use(input.size-1);
     }
     void pop_input() {
+        this->unlock();
+        this->remove_use(input.size-1);
         Node* last_input = input.pop();
-        if(last_input != nullptr) {
-            last_input->output.remove_first_of(this); // remove this from popped node's output
-            // If we removed the last use, the old input is now dead
-            if(last_input->is_unused()) {
-                last_input->kill();
-            }
+        // If we removed the last use, the old input is now dead
+        if(last_input != nullptr && last_input->is_unused()) {
+            last_input->kill();
         }
     }
     void pop_inputs(usize n) {
@@ -171,23 +181,74 @@ struct Node {
     Node* set_input(usize index, Node* new_input) {
         Node* old_input = input[index];
         if(old_input == new_input) return this; // No change
-        if(new_input != nullptr)
-            new_input->output.push(this);
-        // If the old input exists, remove a def->use edge
-        if(old_input != nullptr) {
-            old_input->output.remove_first_of(this); // remove this from last node's output
-            // If we removed the last use, the old input is now dead
-            if(old_input->is_unused())
-                old_input->kill();
-        }
-        // Set the new_def over the old (killed) edge
+        this->unlock(); // about to change the hash
+        this->remove_use(index);
         input[index] = new_input;
-        // Return self for easy flow-coding
+        this->add_use(index);
+        // If we removed the last use, the old input is now dead
+        if(old_input != nullptr && old_input->is_unused())
+            old_input->kill();
         return new_input;
     }
+    // remove the input at `index`, shifting all the following inputs down by one
+    // kill the removed node if it becomes unused
+    void remove_input(usize index) {
+        this->unlock();
+        Node* old_input = input[index];
+        this->remove_use(index);
+        input.remove(index);
+        // the following inputs moved down; their defs have to know
+        for(u32 i = index; i < input.size; i++) {
+            if(input[i] != nullptr && input.back(i) != Edges::NO_BACK) input[i]->output.back(input.back(i)) = i;
+        }
+        if(old_input != nullptr && old_input->is_unused())
+            old_input->kill();
+    }
+    void swap_inputs(u32 i, u32 j) {
+        this->unlock();
+        mem::swap(&input[i], &input[j]);
+        mem::swap(&input.back(i), &input.back(j));
+        if(input[i] != nullptr && input.back(i) != Edges::NO_BACK) input[i]->output.back(input.back(i)) = i;
+        if(input[j] != nullptr && input.back(j) != Edges::NO_BACK) input[j]->output.back(input.back(j)) = j;
+    }
+    // x86 nodes copy the inputs of the node they replace without becoming their users; see `Edges::NO_BACK`
     void copy_inputs(Node* n) {
         assert(this->input.size == 0);
-        this->input.push_slice(n->input.full_slice());
+        for(Node* in : n->input) this->input.push(in);
+    }
+
+    // record `this` as a user of `input[i]`
+    void add_use(u32 i) {
+        Node* def = input[i];
+        if(def == nullptr) { input.back(i) = Edges::NO_BACK; return; }
+        input.back(i) = def->output.size;
+        def->output.push(this, i);
+    }
+    // undo `add_use`; O(1), since the last use of the def takes the place of the removed one
+    void remove_use(u32 i) {
+        Node* def = input[i];
+        u32 pos = input.back(i);
+        if(def == nullptr || pos == Edges::NO_BACK) return;
+        Edges& uses = def->output;
+        u32 last = uses.size-1;
+        if(pos != last) {
+            Node* moved = uses[last];
+            u32 slot = uses.back(last);
+            uses[pos] = moved;
+            uses.back(pos) = slot;
+            moved->input.back(slot) = pos;
+        }
+        uses.pop();
+        input.back(i) = Edges::NO_BACK;
+    }
+    // point the edges of a node that has been copied (`*this = *other`) to its new address
+    void relink() {
+        for(u32 i = 0; i < input.size; i++) {
+            if(input[i] != nullptr && input.back(i) != Edges::NO_BACK) input[i]->output[input.back(i)] = this;
+        }
+        for(u32 p = 0; p < output.size; p++) {
+            output[p]->input[output.back(p)] = this;
+        }
     }
     bool is_unused() {
         return output.empty() && !keepalive;
@@ -197,6 +258,7 @@ struct Node {
     }
     void kill() {
         assert(this->is_unused()); // Has no uses, so it is dead
+        this->unlock();
         this->pop_inputs(input.size); // Set all inputs to null, recursively killing unused Nodes
         type = nullptr; // Flag as dead
         assert(this->is_dead());
@@ -206,10 +268,11 @@ struct Node {
     void subsume(Node* other) {
         assert(other != this);
         while(output.size > 0) {
+            u32 i = output.back(output.size-1);
             Node* n = output.pop();
-            u32 i = n->input.index_of(this);
+            n->unlock(); // `n` gets a new input
             n->input[i] = other;
-            other->output.push(n);
+            n->add_use(i);
         }
         this->kill();
     }
@@ -218,18 +281,29 @@ struct Node {
     void keep() { keepalive = true; }
     void unkeep() { keepalive = false; }
 
-    // void unlock() {
-    //     if(!locked) return;
-    //     Node* old = Node::gvn.remove(ref(this));
-    //     assert(old == this);
-    //     locked = false;
-    // }
-    // void lock() {
-    //     todo;
-    //     if(locked) return;
-    //     Node::gvn.insert(this);
-    //     locked = true;
-    // }
+    // `dep` looked past its direct inputs into `this` while idealizing; revisit `dep` whenever `this` changes
+    // cleared by the iterative peeps when `dep` is put back on the worklist
+    Node* add_dep(Node* dep) {
+        if(dep == this) return this;
+        if(deps == nullptr) deps = Node::node_arena->push(Edges {});
+        if(!deps->contains(dep)) deps->push(dep);
+        return this;
+    }
+
+    // remove from the gvn table; must be called before changing inputs of this node
+    void unlock() {
+        if(!locked) return;
+        Node* old = Node::gvn.remove(this);
+        assert(old == this);
+        locked = false;
+    }
+    // value number this node; return the already existing equivalent node, if any (in which case `this` stays unlocked)
+    Node* lock() {
+        if(locked) return this;
+        Node* found = Node::gvn.get(this);
+        if(found == this) locked = true;
+        return found;
+    }
 
     Op op() {
         return node::op(this);
@@ -293,8 +367,23 @@ struct Node {
     }
     
 };
+static_assert(sizeof(Node) == 64);
 
 namespace node {
+    // number of inputs `Node::place` makes room for, right after the node
+    u32 inline_inputs(NodeType nt) {
+        switch(nt) {
+            case NodeType::Start: return 0;
+            case NodeType::CtrlProj: case NodeType::Proj: case NodeType::Const: return 1;
+            case NodeType::Ret: case NodeType::If: case NodeType::Region: case NodeType::Loop: case NodeType::UnOp: return 2;
+            case NodeType::BinOp: case NodeType::Phi: case NodeType::AllocA: return 3;
+            case NodeType::Load: return 4;
+            case NodeType::Store: return 5;
+            case NodeType::Scope: return 8;
+            default: return 4;
+        }
+    }
+
     NodeType x86_op_r(Op op) {
         switch(op) {
             case Op::Add: return NodeType::x86AddR;
@@ -3,8 +3,19 @@
 #include "node.h"
 #include "compute.h"
 #include "idealize.h"
+#include "hash.h"
 
 namespace node {
+    // if an equivalent node already exists, return it (killing `n` if unused); otherwise make `n` the representative
+    Node* value_number(Node* n) {
+        if(!node::gvn_eligible(n)) return n;
+        Node* found = n->lock();
+        if(found != n && n->is_unused()) {
+            n->kill();
+        }
+        return found;
+    }
+
     Node* peephole(Node* n) {
         assert(n != nullptr);
         assert(n->nt != NodeType::Undefined);
@@ -18,14 +29,21 @@ namespace node {
         
         // no better representation
         if(idealized == nullptr) {
-            return n;
+            return node::value_number(n);
         }
 
-        // better representation found
         // Note that some peepholes modify inputs of a node, but leave the input node `n` valid and return it
-        if(n != idealized && n->is_unused()) {
-            // TODO do I need idealized.keep() and idealized.unkeep()??
+        if(n == idealized) {
+            return node::value_number(n);
+        }
+
+        // better representation found
+        if(n->is_unused()) {
+            // `idealized` may be an input of `n` (such as `x` for `x+0`); don't let killing `n` take it down too
+            bool kept = idealized->keepalive;
+            idealized->keep();
             n->kill();
+            idealized->keepalive = kept;
         }
         return idealized;
     }
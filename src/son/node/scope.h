@@ -1,88 +1,75 @@
 #pragma once
 
 #include "../../core/prelude.h"
-#include "../../core/map.h"
+#include "../../core/pvec.h"
+#include "../../token/symbol.h"
 
 #include "node_def.h"
 
-template <typename T>
+// Variable name -> slot (index in `NodeScope::self.input`)
+// `slots` is indexed by `Sym`, so lookups don't have to go through every nesting level; each definition is recorded in
+// `log` along with the binding it shadowed, so popping a nesting level can undo its definitions
+// every definition pushes exactly one input on the scope node, so a variable's slot is also its index in `log`
+// all three are persistent vectors, so a scope can be duplicated for every branch in O(1); see `PVec`
 struct VariableScope {
-    Vec<HMap<Str,T>> scopes;
+    struct Def {
+        Sym sym;
+        u32 shadowed; // slot `sym` was bound to before this definition; `NONE` if unbound
+    };
 
-    static VariableScope<T> create(mem::Arena& arena) {
-        VariableScope<T> self { .scopes = Vec<HMap<Str,T>>::create(arena) };
+    PVec<u32> slots; // indexed by `Sym`; `NONE` if unbound
+    PVec<Def> log;
+    PVec<u32> levels; // `log.size` at the start of each nesting level
+
+    static constexpr u32 NONE = U32_MAX;
+
+    static VariableScope create(mem::Arena& arena) {
+        VariableScope self { .slots = PVec<u32>::create(arena), .log = PVec<Def>::create(arena), .levels = PVec<u32>::create(arena) };
         self.push();
         return self;
     }
 
     // Push a new scope to be innermost
     void push() {
-        scopes.push(ref(HMap<Str,T>::create(scopes.arena)));
+        levels.push(log.size);
     }
 
     // Pop the innermost scope
     void pop() {
-        scopes.pop();
-    }
-
-    T operator[](Str key) const {
-        for(u32 i = scopes.size-1; i >= 0; i--) {
-            if(scopes[i].exists(key)) {
-                return scopes[i][key];
-            }
+        u32 start = levels.pop();
+        while(log.size > start) {
+            Def d = log.pop();
+            slots.set(d.sym, d.shadowed);
         }
-        return nullptr;
     }
 
-    T& operator[](Str key) {
-        assert(scopes.size > 0);
-        for(u32 i = scopes.size-1; i >= 0; i--) {
-            if(scopes[i].exists(key)) {
-                return scopes[i][key];
-            }
-        }
-        panic;
+    // `NONE` if not defined
+    u32 operator[](Sym key) const {
+        return key < slots.size ? slots[key] : NONE;
     }
 
     // Define a variable in the innermost scope
-    void define(Str var_name, T& value) {
-        scopes.back().add(var_name, value);
+    void define(Sym key, u32 slot) {
+        assert(slot == log.size);
+        while(slots.size <= key) slots.push(NONE);
+        log.push(Def { .sym = key, .shadowed = slots[key] });
+        slots.set(key, slot);
     }
 
-    bool contains(Str key) {
-        for(u32 i = scopes.size-1; i >= 0; i--) {
-            if(scopes[i].exists(key)) {
-                return true;
-            }
-        }
-        return false;
-    }
-
-    HMap<Str,T>& top() {
-        return scopes.back();
+    bool contains(Sym key) const {
+        return (*this)[key] != NONE;
     }
 
     usize top_size() {
-        return scopes.back().size;
+        return log.size - levels.back();
     }
 
-    // relatively expensive
-    Str key_of(T value) {
-        for(u32 i = scopes.size-1; i >= 0; i--) {
-            Maybe<Str> key = scopes[i].key_of(value);
-            if(key.here) {
-                return key.val;
-            }
-        }
-        panic;
+    Sym key_of(u32 slot) {
+        return log[slot].sym;
     }
 
-    VariableScope<T> deep_clone() {
-        VariableScope<T> c { .scopes = Vec<HMap<Str,T>>::create(*scopes.arena) };
-        c.scopes = this->scopes.clone(scopes.arena);
-        for(u32 i = 0; i < scopes.size; i++) {
-            c.scopes[i] = scopes[i].clone(scopes.arena);
-        }
-        return c;
+    // O(1); the copies share everything until either one is changed
+    VariableScope deep_clone() {
+        return VariableScope { .slots = slots.clone(), .log = log.clone(), .levels = levels.clone() };
     }
-};
\ No newline at end of file
+};
@@ -7,21 +7,23 @@ struct Node;
 struct NodeScope;
 typedef Node CFGNode;
 
+// The compiler's state is thread_local, so that every thread can compile a file of its own (see `CompilationContext`)
+
 // Special nodes
-Node* VOID_NODE;
-CFGNode* START_NODE;
-CFGNode* STOP_NODE;
+thread_local Node* VOID_NODE;
+thread_local CFGNode* START_NODE;
+thread_local CFGNode* STOP_NODE;
 
 // Scope nodes
-NodeScope* SCOPE_NODE;
-NodeScope* BREAK_SCOPE_NODE;
-NodeScope* CONTINUE_SCOPE_NODE;
+thread_local NodeScope* SCOPE_NODE;
+thread_local NodeScope* BREAK_SCOPE_NODE;
+thread_local NodeScope* CONTINUE_SCOPE_NODE;
 
 namespace node {
     // to index into these vectors, use `CFGNode::cfgid` that's assigned during `compute_idom`
-    u32 cfg_size; // number of cfg nodes in the graph
-    Vec<CFGNode*> cfgrp; // reverse postordering of cfg nodes
-    Vec<CFGNode*> dom; // array of immidiate dominators of all cfg nodes
-    Vec<u32> domdepth; // depth in the dominator tree for all cfg nodes
-    Vec<u32> loopdepth; // loop depth of all cfg nodes
+    thread_local u32 cfg_size; // number of cfg nodes in the graph
+    thread_local Vec<CFGNode*> cfgrp; // reverse postordering of cfg nodes
+    thread_local Vec<CFGNode*> dom; // array of immidiate dominators of all cfg nodes
+    thread_local Vec<u32> domdepth; // depth in the dominator tree for all cfg nodes
+    thread_local Vec<u32> loopdepth; // loop depth of all cfg nodes
 };
\ No newline at end of file
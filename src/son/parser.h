@@ -2,8 +2,10 @@
 
 #include "prelude.h"
 
-#include "../token/tokenizer.h"
+#include "../token/token_stream.h"
 #include "../lang/util.h"
+#include "../lang/number.h"
+#include "../lang/diagnostic.h"
 
 #include "type.h"
 #include "node.h"
@@ -12,16 +14,111 @@
 // use __TOKEN__ for value of read token
 #define read_token_or_err(expect_token, err_msg) { if(!this->read_token(expect_token)) { error = err_msg; return nullptr; }}
 
+// Parses the tokens straight into the graph
+// A function that fails sets `error` and returns `nullptr` up to the statement it's in. The statement is then abandoned
+// (panic mode): the error becomes a diagnostic, and parsing picks up after the `;` or `}` that ends the statement. So
+// one parse reports every error instead of only the first. Headers of `if` and `while` recover on the spot, standing
+// in a poison value for a bad condition, so the control flow around a body is always built whole; a `let` that fails
+// still defines its variable as poison, so later uses don't report errors of their own.
+// After any error, the graph is only good for finding more errors.
 struct Parser {
-    Tokenizer t;
-    Str error;
+    TokenStream tokens;
+    Str error; // of the statement being parsed
+    Vec<Diagnostic> diagnostics;
 
-    static Parser create(Str src) {
-        return Parser { .t = Tokenizer::create(src), .error = PARSER_NO_ERROR };
+    static Parser create(TokenStream tokens, mem::Arena& arena = default_arena) {
+        return Parser { .tokens = tokens, .error = PARSER_NO_ERROR, .diagnostics = Vec<Diagnostic>::create(arena) };
+    }
+
+    // parse every statement; false if there were errors (see `diagnostics`)
+    bool parse() {
+        while(!tokens.eof()) {
+            u64 start = tokens.position();
+            this->next_top_level_expr();
+            if(this->err()) {
+                this->recover();
+                if(tokens.position() == start) tokens.next(); // a stray `}`, which nothing else skips
+            }
+        }
+        return diagnostics.empty();
+    }
+
+    /* Errors */
+
+    // turn `error` into a diagnostic at the next token
+    // the first error at a position is the one that matters; anything after it there is a consequence
+    void report() {
+        u64 at = tokens.position();
+        if(diagnostics.empty() || diagnostics.back().offset != at) diagnostics.push(Diagnostic { .message = error, .offset = at });
+        error = PARSER_NO_ERROR;
+    }
+
+    // skip the rest of a failed statement, up to its `;` or `}` (but not past it), stepping over nested brackets
+    // a keyword that starts a statement ends it too, so a missing `;` doesn't take the next statement with it
+    // with `in_parens`, stop at the `)` of a condition (or the `{` of the body after it) as well
+    void synchronize(bool in_parens) {
+        u32 depth = 0;
+        while(!tokens.eof()) {
+            TokenType tt = tokens.peek();
+            if(depth == 0) {
+                switch(tt) {
+                    case TokenType::EndOfLine:
+                    case TokenType::RightCurly:
+                    case TokenType::VarDecl:
+                    case TokenType::Return:
+                    case TokenType::If:
+                    case TokenType::While:
+                    case TokenType::Break:
+                    case TokenType::Continue:
+                        return;
+                    default:
+                        break;
+                }
+                if(in_parens && (tt == TokenType::RightParenthese || tt == TokenType::LeftCurly)) return;
+            }
+            if(tt == TokenType::LeftCurly || tt == TokenType::LeftParenthese || tt == TokenType::LeftBracket) depth++;
+            else if((tt == TokenType::RightCurly || tt == TokenType::RightParenthese || tt == TokenType::RightBracket) && depth > 0) depth--;
+            tokens.next();
+        }
+    }
+
+    // report the error of a statement and move on to the next one
+    void recover() {
+        this->report();
+        this->synchronize(false);
+        if(tokens.peek() == TokenType::EndOfLine) tokens.next();
+    }
+
+    // stands in for an expression that failed to parse
+    Node* poison() {
+        return NodeConst::create(type::pool.get_bottom(TypeT::Int));
+    }
+
+    // `(<expr>)` after `if` or `while`; never fails, except at the end of the file
+    // errors are reported right here, and a condition that doesn't parse becomes poison
+    Node* next_condition(Str keyword) {
+        if(!this->read_token(TokenType::LeftParenthese)) {
+            Str errlist[3] = { "expected '(' after '"_s, keyword, "'"_s };
+            error = str::concat(errlist, 3);
+            this->report(); // and go on as if it was there
+        }
+        Node* condition = this->next_primary_expr();
+        if(condition == nullptr) {
+            if(tokens.eof()) return nullptr;
+            this->report();
+            this->synchronize(true);
+            condition = this->poison();
+        }
+        if(!this->read_token(TokenType::RightParenthese)) {
+            Str errlist[3] = { "expected ')' after the '"_s, keyword, "' condition"_s };
+            error = str::concat(errlist, 3);
+            this->report();
+        }
+        return condition;
     }
 
     bool done() {
-        return t.eof();
+        return tokens.eof();
     }
 
     bool err() {
@@ -31,14 +128,16 @@ struct Parser {
     Node* next_term() {
         Node* node = this->next_symbol();
         if(node == nullptr) return nullptr;
-        if(t.peek_non_white() == '.') {
+        if(tokens.peek_is("."_s)) {
             // TODO member access here
-            todo;
-        } else if(t.peek_non_white() == '[') {
+            error = "member access isn't supported yet"_s;
+            return nullptr;
+        } else if(tokens.peek() == TokenType::LeftBracket) {
             this->read_token(TokenType::LeftBracket);
             Node* index = this->next_primary_expr(); 
             if(index == nullptr) return nullptr;
             if(!this->read_token(TokenType::RightBracket)) { error = "Expected ]"_s; return nullptr; }
+            if(this->dead()) return this->poison(); // no memory to load from
             Node* mem = SCOPE_NODE->find("$1"_s); // TODO hardcoded
             Node* offset = NodeBinOp::create(Op::Mul, index, NodeConst::create(8)); // TODO hardcoded
             Node* load_node = NodeLoad::create(1, mem, node, offset); // TODO hardcoded
@@ -47,22 +146,46 @@ struct Parser {
         return node;
     }
 
+    // errors point at the token they're about, so it's only read once it's known to be good
     Node* next_symbol() {
-        Token token = t.next_token();
+        Token token = tokens.peek_token();
 
         switch(token.tt) {
             case TokenType::IntLiteral: {
-                return NodeConst::create(type::pool.int_const(str::to_int<u64>(token.val)));
+                Maybe<u64> val = num::parse_int(token.val);
+                if(!val.here || val.val > I64_MAX) {
+                    Str errlist[2] = { "integer literal is malformed or doesn't fit in an i64: "_s, token.val };
+                    error = str::concat(errlist, 2);
+                    return nullptr;
+                }
+                tokens.next();
+                return NodeConst::create(type::pool.int_const(val.val));
             }
 
             // Unary operator; read the next term (operand)
             case TokenType::Special: {
+                Op op = op::resolve(token.val, false);
+                if(op == Op::Undefined) {
+                    Str errlist[2] = { "expected a unary operator, but found "_s, token.val };
+                    error = str::concat(errlist, 2);
+                    return nullptr;
+                }
+                tokens.next();
+                // -2^63 fits in an i64 even though 2^63 doesn't, so that literal is only allowed right here
+                if(op == Op::Neg && tokens.peek() == TokenType::IntLiteral) {
+                    Maybe<u64> val = num::parse_int(tokens.peek_token().val);
+                    if(val.here && val.val == (u64) I64_MAX + 1) {
+                        tokens.next();
+                        return NodeConst::create(type::pool.int_const(I64_MIN));
+                    }
+                }
                 Node* operand_expr = this->next_term();
                 if(operand_expr == nullptr) return nullptr;
-                return NodeUnOp::create(op::unary(token.val), operand_expr);
+                return NodeUnOp::create(op, operand_expr);
             }
 
             case TokenType::LeftParenthese: {
+                tokens.next();
                 Node* expr = this->next_primary_expr();
                 if(expr == nullptr) return nullptr;
                 if(!this->read_token(TokenType::RightParenthese)) {
@@ -74,36 +197,41 @@ struct Parser {
             
             // Read variable name or function call (including all args and both parentheses)
             case TokenType::Identifier: {
+                Node* value = this->dead() ? this->poison() : SCOPE_NODE->find(token.sym);
+                if(value == nullptr) {
+                    Str errlist[3] = { "variable "_s, token.val, " is not defined"_s};
+                    // error = str::from_slice_of_str(ref(Slice<Str>::from_ptr(errlist, 3)));
+                    error = str::concat(errlist, 3);
+                    return nullptr;
+                }
+                tokens.next();
                 // only function calls have `(` after the identifier
-                if(t.peek_non_white() == '(') {
-                    todo;
-                } else {
-                    Node* value = SCOPE_NODE->find(token.val);
-                    if(value == nullptr) {
-                        Str errlist[3] = { "variable "_s, token.val, " is not defined"_s};
-                        // error = str::from_slice_of_str(ref(Slice<Str>::from_ptr(errlist, 3)));
-                        error = str::concat(errlist, 3);
-                        return nullptr;
-                    }
-                    return value;
+                if(tokens.peek() == TokenType::LeftParenthese) {
+                    error = "function calls aren't supported yet"_s;
+                    return nullptr;
                 }
+                return value;
             }
 
             case TokenType::FloatLiteral: {
-                todo;
+                // TODO floats; parse the literal once compute, idealize, the evaluator and codegen handle them
+                error = "float literals aren't supported yet"_s;
+                return nullptr;
             }
 
             case TokenType::LeftBracket: {
-                todo; // array literal
+                error = "array literals aren't supported yet"_s;
+                return nullptr;
             }
 
             case TokenType::LeftCurly: {
-                todo;
+                error = "a block can't be used as a value yet"_s;
+                return nullptr;
             }
 
             case TokenType::If: {
-                todo;
-                return this->next_if(token);
+                error = "an if can't be used as a value yet"_s;
+                return nullptr;
             }
 
             case TokenType::EndOfLine: {
@@ -112,6 +240,7 @@ struct Parser {
             }
 
             case TokenType::EndOfFile:
+                error = "Expected an expression, but the file ended"_s;
                 return nullptr;
 
             // Unexpected syntax
@@ -136,46 +265,58 @@ struct Parser {
     // `nullptr` means that source has been fully parsed or an error occurred
     // does consume the tailing `;`
     Node* next_top_level_expr() {
-        Token token = t.next_token();
+        tokens.release(); // statements only hold on to their own tokens, so a streaming source can free what's before
+        Token token = tokens.peek_token(); // read by each case, so an unexpected token is reported where it is
 
         switch(token.tt) {
             case TokenType::Return: {
+                tokens.next();
                 Node* ret_expr = this->next_primary_expr();
                 if(ret_expr == nullptr) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
+                if(this->dead()) return this->poison();
                 Node* node_ret = NodeRet::create(SCOPE_NODE->ctrl(), ret_expr);
                 STOP_NODE->push_input(node_ret); // register the return with the stop node
+                // nothing after a return is reachable
+                NodeScope* returned = SCOPE_NODE;
+                SCOPE_NODE = NodeScope::create_xctrl();
+                if(((Node*)returned)->is_unused()) ((Node*)returned)->kill();
                 return node_ret;
             }
             
             case TokenType::VarDecl: {
-                Token var_name = t.next_token();
-                if(!this->read_token(":"_s)) { error = "Expected type when declaring a variable"_s; return nullptr; }
+                tokens.next();
+                Token var_name = tokens.peek_token();
+                if(var_name.tt != TokenType::Identifier) { error = "Expected a variable name after 'let'"_s; return nullptr; }
+                tokens.next();
+                // past the name, a failed declaration still declares the variable, as poison
+                if(!this->read_token(":"_s)) { error = "Expected type when declaring a variable"_s; return this->define_poison(var_name); }
                 Type* declared_type = this->next_type();
-                if(declared_type == nullptr) return nullptr;
+                if(declared_type == nullptr) return this->define_poison(var_name);
                 Node* initializer_expr;
-                if(t.peek_non_white() == '=') {
+                if(tokens.peek_is("="_s)) {
                     this->read_token("="_s); // will succeed
                     initializer_expr = this->next_primary_expr();
-                    if(initializer_expr == nullptr) return nullptr;
+                    if(initializer_expr == nullptr) return this->define_poison(var_name);
                 } else {
                     initializer_expr = NodeConst::create(type::default_val(declared_type));
                 }
-                SCOPE_NODE->define(var_name.val, initializer_expr); // Defining var here
+                SCOPE_NODE->define(var_name.sym, initializer_expr); // Defining var here
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
                 return initializer_expr;
             }
             
             // Variable assignment
             case TokenType::Identifier: {
-                if(t.peek_non_white() == '=') {
+                tokens.next();
+                if(tokens.peek_is("="_s)) {
                     this->read_token("="_s);
                     Node* new_expr = this->next_primary_expr();
                     if(new_expr == nullptr) return nullptr;
-                    SCOPE_NODE->update(token.val, new_expr); // Updating var here
+                    SCOPE_NODE->update(token.sym, new_expr); // Updating var here
                     if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
                     return new_expr;
-                } else if(t.peek_non_white() == '[') {
+                } else if(tokens.peek() == TokenType::LeftBracket) {
                     this->read_token(TokenType::LeftBracket);
                     Node* index = this->next_primary_expr(); 
                     if(index == nullptr) return nullptr;
@@ -188,8 +329,9 @@ struct Parser {
                     if(expr == nullptr) return nullptr;
                     expr->keep();
                     if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
+                    if(this->dead()) { expr->unkeep(); return expr; } // no memory to store into
                     Node* mem = SCOPE_NODE->find("$1"_s); // TODO alias hardcoded
-                    Node* ptr = SCOPE_NODE->find(token.val);
+                    Node* ptr = SCOPE_NODE->find(token.sym);
                     Node* offset = NodeBinOp::create(Op::Mul, index, NodeConst::create(8)); // TODO offset hardcoded
                     expr->unkeep();
                     Node* store_node = NodeStore::create(1, mem, ptr, offset, expr); // TODO alias hardcoded
@@ -201,6 +343,7 @@ struct Parser {
             }
 
             case TokenType::LeftCurly: {
+                tokens.next();
                 Node* block_expr = this->next_block_expr();
                 if(block_expr == nullptr) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
@@ -208,6 +351,7 @@ struct Parser {
             }
 
             case TokenType::If: {
+                tokens.next();
                 Node* if_expr = this->next_if(token);
                 if(if_expr == nullptr) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
@@ -215,6 +359,7 @@ struct Parser {
             }
 
             case TokenType::While: {
+                tokens.next();
                 Node* while_expr = this->next_while(token);
                 if(while_expr == nullptr) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
@@ -222,6 +367,7 @@ struct Parser {
             }
 
             case TokenType::Break: {
+                tokens.next();
                 this->apply_break();
                 if(this->err()) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
@@ -229,6 +375,7 @@ struct Parser {
             }
 
             case TokenType::Continue: {
+                tokens.next();
                 this->apply_continue();
                 if(this->err()) return nullptr;
                 if(!this->read_token(TokenType::EndOfLine)) { error = "Expected ;"_s; return nullptr; }
@@ -237,6 +384,7 @@ struct Parser {
 
             // skip empty expressions
             case TokenType::EndOfLine:
+                tokens.next();
                 return this->next_top_level_expr();
             
             case TokenType::EndOfFile:
@@ -251,67 +399,40 @@ struct Parser {
         }
     }
 
+    // declare `name` as poison after its declaration failed; always `nullptr`, so the statement still fails
+    Node* define_poison(Token name) {
+        SCOPE_NODE->define(name.sym, this->poison());
+        return nullptr;
+    }
+
     // parse the entire primary expression with correct operator precidence
     Node* next_primary_expr() {
-        mem::Arena local = mem::Arena::create(32 KB);
-        Vec<Token> op_stack = Vec<Token>::create(local);
-        Vec<Node*> val_stack = Vec<Node*>::create(local);
-
-        // parse until find a terminal symbol (in the body)
-        while(true) {
-            // read the next operand
-            val_stack.push(ref(this->next_term()));
-            if(val_stack.back() == nullptr) return nullptr;
-
-            // expect operator or terminal symbol (`)`, `]`, `}`, `;`, `,` or eof)
-            if(ch::terminal(t.peek_non_white())) {
-                // apply the remaining ops, in order
-                while(op_stack.size > 0) {
-                    assert(val_stack.size >= 2);
-                    Token apply_op = op_stack.pop();
-                    Node* rhs = val_stack.pop();
-                    Node* lhs = val_stack.pop();
-                    assert(rhs != nullptr);
-                    assert(lhs != nullptr);
-                    // apply operands to the op
-                    Node* applied = NodeBinOp::from_token(lhs, rhs, apply_op);
-                    // push it back
-                    val_stack.push(applied);
-                }
-                assert(val_stack.size == 1);
-                return val_stack[0];
-            }
-
-            // assume an operator
-            Token op_node = this->read_binop();
-            if(this->err()) { return nullptr; }
-
-            // Assignment is special
-            if(op::from_str(op_node.val) == Op::Assignment) {
-                printe("cannot parse = in build_primary_expr", "bad syntax");
-                panic;
-            }
+        return this->next_binary_expr(1);
+    }
 
-            // apply if conditions are met (a modified version of the shunting yard algorithm)
-            while(op_stack.size > 0 && op::has_precedence(
-                op::from_str(op_stack.back().val),
-                op::from_str(op_node.val)
-            )) {
-                assert(val_stack.size >= 2);
-                Token apply_op = op_stack.pop();
-                Node* rhs = val_stack.pop();
-                Node* lhs = val_stack.pop();
-                assert(rhs != nullptr);
-                assert(lhs != nullptr);
-                // apply operands to the op
-                Node* applied = NodeBinOp::from_token(lhs, rhs, apply_op);
-                // push it back
-                val_stack.push(applied);
+    // operands joined by binary operators that bind at least as tightly as `min_prec` (see `op::binding`)
+    // precedence climbing: recurses once per precedence level, not once per operator, and allocates nothing
+    // stops at a terminal symbol (`)`, `]`, `}`, `;`, `,` or eof) and leaves it for the caller
+    Node* next_binary_expr(u8 min_prec) {
+        Node* lhs = this->next_term();
+        if(lhs == nullptr) return nullptr;
+        while(!tokens.peek_terminal()) {
+            Token token = tokens.peek_token();
+            Op op = token.tt == TokenType::Special ? op::resolve(token.val, true) : Op::Undefined;
+            if(op == Op::Undefined) {
+                Str errlist[2] = { "expected a binary operator, but found "_s, token.val };
+                error = str::concat(errlist, 2);
+                return nullptr;
             }
-
-            // push the new operator onto the stack
-            op_stack.push(op_node);
+            if(op == Op::Assignment) { error = "'=' can't be used inside of an expression"_s; return nullptr; }
+            op::Binding b = op::binding(op);
+            if(b.prec < min_prec) break;
+            tokens.next();
+            Node* rhs = this->next_binary_expr(b.right_assoc ? b.prec : b.prec + 1);
+            if(rhs == nullptr) return nullptr;
+            lhs = NodeBinOp::create(op, lhs, rhs);
         }
+        return lhs;
     }
 
     // Assume that the leading `{` has already been read
@@ -320,23 +441,45 @@ struct Parser {
     Node* next_block_expr() {
         SCOPE_NODE->push();
         Node* expr = nullptr;
-        while(t.peek_non_white() != '}') {
+        while(tokens.peek() != TokenType::RightCurly) {
+            if(tokens.eof()) { error = "Expected }, but the file ended"_s; return nullptr; }
+            if(tokens.peek() == TokenType::EndOfLine) { tokens.next(); continue; } // an empty statement, maybe right before the `}`
             expr = this->next_top_level_expr();
-            if(expr == nullptr) return nullptr;
+            if(this->err()) {
+                this->recover();
+                expr = this->poison();
+            }
         }
         SCOPE_NODE->pop();
-        if(expr == nullptr) { error = "Empty block is not allowed"_s; return nullptr; }
-        if(!this->read_token(TokenType::RightCurly)) { error = "Expected }"_s; return nullptr; }
+        this->read_token(TokenType::RightCurly); // will succeed
+        if(expr == nullptr) {
+            error = "Empty block is not allowed"_s;
+            this->report();
+            return this->poison();
+        }
         // return NodeConst::create(type::pool.bottom(), START_NODE);
         return expr;
     }
 
+    // after a `return` or `break` the scope is xctrl; there's no ctrl to build on, so unreachable code is only parsed
+    // (for its errors) and stands for poison
+    bool dead() {
+        return SCOPE_NODE->is_xctrl();
+    }
+
     // Assume that `if` has already been read and accept it as argument `token`
     Node* next_if(Token token) {
-        if(!this->read_token(TokenType::LeftParenthese)) { error = "expected '(' after 'if'"_s; return nullptr; }
-        Node* condition = this->next_primary_expr();
+        Node* condition = this->next_condition("if"_s);
         if(condition == nullptr) return nullptr;
-        if(!this->read_token(TokenType::RightParenthese)) { error = "condition has to end with ')'"_s; return nullptr; }
+        if(this->dead()) {
+            if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'if' condition"_s; this->report(); }
+            if(this->next_block_expr() == nullptr) return nullptr;
+            if(this->read_token(TokenType::Else)) {
+                if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'else'"_s; this->report(); }
+                if(this->next_block_expr() == nullptr) return nullptr;
+            }
+            return this->poison();
+        }
 
         Node* if_node = NodeIf::create(SCOPE_NODE->ctrl(), condition);
 
@@ -351,7 +494,7 @@ struct Parser {
         // Parse the true side
 
         SCOPE_NODE->update_ctrl(proj_true);
-        if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'if' condition"_s; return nullptr; }
+        if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'if' condition"_s; this->report(); }
         Node* true_branch = this->next_block_expr();
         if(true_branch == nullptr) return nullptr;
         // assert(true_branch->type->tinfo == TypeI::Bottom);
@@ -361,14 +504,14 @@ struct Parser {
 
         SCOPE_NODE = scope_false;
         SCOPE_NODE->update_ctrl(proj_false);
-        if(t.peek_non_white() != ';') {
-            // there's an else clause
-            if(!this->read_token(TokenType::Else)) { error = "expected 'else' clause"_s; return nullptr; }
-            if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'if'"_s; return nullptr; }
+        if(tokens.peek() == TokenType::Else) {
+            this->read_token(TokenType::Else);
+            if(!this->read_token(TokenType::LeftCurly)) { error = "expected '{' after 'else'"_s; this->report(); }
             Node* false_branch = this->next_block_expr();
             if(false_branch == nullptr) return nullptr;
             scope_false = SCOPE_NODE;
         }
+        // anything else is left for the `;` check after the statement
 
         // assert(scope_true->self.input.size == scope_false->self.input.size); // TODO
 
@@ -376,26 +519,19 @@ struct Parser {
         scope_true->merge(scope_false);
         SCOPE_NODE = scope_true;
 
-        return SCOPE_NODE->ctrl();
-    }
-
-    Token read_binop() {
-        Token token = t.next_binary_op();
-        if(token.tt == TokenType::Special) {
-            return token;
-        }
-        Str errlist[2] = { "expected an binary operator, but found "_s, token.val };
-        error = str::from_slice_of_str(ref(Slice<Str>::from_ptr(errlist, 2)));
-        return {}; // return garbage, since an error occurred
+        return this->dead() ? this->poison() : SCOPE_NODE->ctrl(); // dead if both sides returned
     }
 
+    // read the next token if it's the expected one; otherwise leave it, for the error to point at and recovery to see
     bool read_token(TokenType tt) {
-        Token token = t.next_token();
-        return token.tt == tt;
+        if(tokens.peek() != tt) return false;
+        tokens.next();
+        return true;
     }
     bool read_token(Str val) {
-        Token token = t.next_token();
-        return token.val == val;
+        if(!tokens.peek_is(val)) return false;
+        tokens.next();
+        return true;
     }
 
     // assume that `while` has been read and passed as argument `while_token`
@@ -403,6 +539,21 @@ struct Parser {
         NodeScope* save_break_scope = BREAK_SCOPE_NODE;
         NodeScope* save_continue_scope = CONTINUE_SCOPE_NODE;
 
+        if(this->dead()) {
+            Node* condition = this->next_condition("while"_s);
+            if(condition == nullptr) return nullptr;
+            // `break` and `continue` in the body are fine, and go nowhere
+            BREAK_SCOPE_NODE = NodeScope::create_xctrl();
+            CONTINUE_SCOPE_NODE = nullptr;
+            if(!this->read_token(TokenType::LeftCurly)) { error = "Expected a block as 'while' body"_s; this->report(); }
+            Node* block_ret = this->next_block_expr();
+            CONTINUE_SCOPE_NODE = save_continue_scope;
+            BREAK_SCOPE_NODE = save_break_scope;
+            if(block_ret == nullptr) return nullptr;
+            SCOPE_NODE = NodeScope::create_xctrl(); // the body might have left its own dead scope behind
+            return this->poison();
+        }
+
         // note that loop_node->input[1] is nullptr until the loop is fully parsed
         SCOPE_NODE->update_ctrl(NodeRegion::create_incomplete(SCOPE_NODE->ctrl()));
         
@@ -412,10 +563,8 @@ struct Parser {
         // Make SCOPE_NODE the loop body scope
         SCOPE_NODE = head->duplicate_with_sentinel();
 
-        if(!this->read_token(TokenType::LeftParenthese)) { error = "Expected '(' after 'while'"_s; return nullptr; }
-        Node* condition = this->next_primary_expr();
-        if(condition == nullptr) { return nullptr; }
-        if(!this->read_token(TokenType::RightParenthese)) { error = "Expected ')' after 'while' condition"_s; return nullptr; }
+        Node* condition = this->next_condition("while"_s);
+        if(condition == nullptr) return nullptr;
         Node* loop_cond_node = NodeIf::create(SCOPE_NODE->ctrl(), condition);
         loop_cond_node->keep();
         Node* proj_t = NodeProj::create(0, loop_cond_node, true);
@@ -430,7 +579,7 @@ struct Parser {
 
         // Parse the true side = loop body
         SCOPE_NODE->update_ctrl(proj_t);
-        if(!this->read_token(TokenType::LeftCurly)) { error = "Expected a block as 'while' body"_s; return nullptr; }
+        if(!this->read_token(TokenType::LeftCurly)) { error = "Expected a block as 'while' body"_s; this->report(); }
         Node* block_ret = this->next_block_expr();
         if(block_ret == nullptr) return nullptr;
 
@@ -439,6 +588,12 @@ struct Parser {
             SCOPE_NODE->merge(CONTINUE_SCOPE_NODE); // TODO should be sufficient, right?
             CONTINUE_SCOPE_NODE = nullptr; // no references to dead nodes
         }
+        if(this->dead()) {
+            // every way through the body leaves the loop, so nothing comes back around: the back edge is an xctrl
+            // constant (sccp cuts it), and every variable comes back as it went in
+            SCOPE_NODE = head->duplicate();
+            SCOPE_NODE->update_ctrl(NodeConst::create(type::pool.xctrl));
+        }
         assert(SCOPE_NODE->self.input.size != 0);
 
         // The true branch loops back, so whatever is current _scope.ctrl gets
@@ -466,17 +621,20 @@ struct Parser {
     }
 
     Type* next_type() {
-        Token base_type_t = t.next_type(); // will not include tailing '*' and '[num]'
-        if(base_type_t.val != "i64"_s) { error = "The only supported primitive type is i64"_s; return nullptr; }
+        Token base_type_t = tokens.peek_token(); // the base type is an identifier; followed by '*' or '[num]'
+        if(base_type_t.tt != TokenType::Identifier || base_type_t.val != "i64"_s) { error = "The only supported primitive type is i64"_s; return nullptr; }
+        tokens.next();
         Type* base_type = type::pool.int_sized(8);
-        if(t.peek_non_white() == '*') { error = "Pointers not supported yet"_s; return nullptr; }
-        if(t.peek_non_white() == '[') {
-            t.at++;
-            Str arr_size_str = t.parse_number_literal();
-            i64 arr_size = str::to_int<i64>(arr_size_str);
-            if(t.peek_non_white() != ']') { error = "Expected ] after number in the type"_s; return nullptr; }
-            t.at++;
-            return type::pool.ptr_to(base_type, arr_size);
+        if(tokens.peek_is("*"_s)) { error = "Pointers not supported yet"_s; return nullptr; }
+        if(tokens.peek() == TokenType::LeftBracket) {
+            tokens.next();
+            Token arr_size_t = tokens.peek_token();
+            if(arr_size_t.tt != TokenType::IntLiteral) { error = "Expected a number as the array size"_s; return nullptr; }
+            Maybe<u64> arr_size = num::parse_int(arr_size_t.val);
+            if(!arr_size.here || arr_size.val > U32_MAX) { error = "Array size is too big"_s; return nullptr; }
+            tokens.next();
+            if(!this->read_token(TokenType::RightBracket)) { error = "Expected ] after number in the type"_s; return nullptr; }
+            return type::pool.ptr_to(base_type, arr_size.val);
         }
         return base_type;
     }
@@ -500,8 +658,8 @@ struct Parser {
             CONTINUE_SCOPE_NODE = SCOPE_NODE;
         } else {
             CONTINUE_SCOPE_NODE->merge(SCOPE_NODE);
-            SCOPE_NODE = NodeScope::create_xctrl();
         }
+        SCOPE_NODE = NodeScope::create_xctrl();
     }
 
     bool is_loop_active() {
@@ -10,8 +10,10 @@
 
 #include "../core/str.h"
 #include "../core/vec.h"
+#include "../core/smallvec.h"
 #include "../core/map.h"
 #include "../core/set.h"
+#include "../core/bitset.h"
 
 Str PARSER_NO_ERROR = ""_s;
 Str CTRL_STR = "$ctrl"_s;
\ No newline at end of file
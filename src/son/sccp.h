@@ -0,0 +1,310 @@
+#pragma once
+
+#include "node.h"
+
+// Sparse Conditional Constant Propagation
+// Unlike `node::compute` (which runs once, when a node is created, and is pessimistic about incomplete loops), every
+// node starts at Top and only moves down as the graph is walked from Start. Control only flows through the `CtrlProj`s
+// of an `If` whose condition allows it, so values coming from branches that are never taken don't pollute the phis.
+//
+// The lattice is kept to three levels to guarantee termination (ranges could keep widening around a loop):
+//  data: `type::pool.top` -> int constant -> `type::pool.bottom`
+//  ctrl: `type::pool.xctrl` (unreachable) -> `type::pool.ctrl` (reachable)
+namespace sccp {
+    struct Stats {
+        u32 iterations; // number of nodes popped off the worklist
+        u32 constants; // number of data nodes replaced by a constant
+        u32 branches; // number of `If`s with a single reachable side that have been removed
+        u32 swept; // number of unreachable nodes removed
+    };
+
+    struct State {
+        Type** vals; // indexed by uid; nullptr = not visited yet (top/xctrl)
+        u32 size;
+    };
+
+    Type* value(State& s, Node* n) {
+        if(n == nullptr) return type::pool.top;
+        Type* t = n->uid < s.size ? s.vals[n->uid] : nullptr;
+        if(t != nullptr) return t;
+        return n->cfg() ? type::pool.xctrl : type::pool.top;
+    }
+
+    bool reachable(State& s, Node* n) {
+        return sccp::value(s, n) == type::pool.ctrl;
+    }
+
+    bool is_int_const(Type* t) {
+        return t->ttype == TypeT::Int && type::constant(t);
+    }
+
+    Type* meet(Type* a, Type* b) {
+        if(a == type::pool.top) return b;
+        if(b == type::pool.top) return a;
+        if(a == b) return a;
+        return type::pool.bottom;
+    }
+
+    // ops that `op::apply` can evaluate
+    bool foldable(Op op) {
+        switch(op) {
+            case Op::Add: case Op::Sub: case Op::Mul: case Op::Div: case Op::Mod:
+            case Op::Eq: case Op::Neq: case Op::Less: case Op::Greater: case Op::LessEq: case Op::GreaterEq:
+            case Op::Neg: case Op::BitNot: case Op::LogiNot:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // the value of `n` given the current values of its inputs
+    Type* transfer(State& s, Node* n) {
+        switch(n->nt) {
+            case NodeType::Start:
+                return type::pool.ctrl;
+
+            case NodeType::If:
+            case NodeType::Ret:
+                return sccp::value(s, n->input[0]);
+
+            case NodeType::Stop:
+            case NodeType::Region:
+            case NodeType::Loop: {
+                for(Node* in : n->input)
+                    if(sccp::reachable(s, in)) return type::pool.ctrl;
+                return type::pool.xctrl;
+            }
+
+            case NodeType::CtrlProj: {
+                NodeProj* node = (NodeProj*) n;
+                Node* src = node->ctrl();
+                if(!sccp::reachable(s, src)) return type::pool.xctrl;
+                if(src->nt != NodeType::If) return type::pool.ctrl;
+                Type* cond = sccp::value(s, ((NodeIf*) src)->condition());
+                if(cond == type::pool.top) return type::pool.xctrl; // nothing is known yet; don't take either side
+                if(!sccp::is_int_const(cond)) return type::pool.ctrl;
+                bool taken = ((TypeInt*) cond)->val() != 0;
+                return taken == (node->index == 0) ? type::pool.ctrl : type::pool.xctrl; // index 0 is the true side
+            }
+
+            case NodeType::Phi: {
+                NodePhi* node = (NodePhi*) n;
+                Node* region = node->region();
+                if(!sccp::reachable(s, region)) return type::pool.top;
+                Type* t = type::pool.top;
+                for(u32 i = 0; i < node->data_size(); i++) {
+                    if(!sccp::reachable(s, region->input[i])) continue; // ignore values coming from dead paths
+                    t = sccp::meet(t, sccp::value(s, node->data(i)));
+                }
+                return t;
+            }
+
+            case NodeType::Const: {
+                NodeConst* node = (NodeConst*) n;
+                return sccp::is_int_const(node->val) ? node->val : type::pool.bottom;
+            }
+
+            case NodeType::BinOp: {
+                NodeBinOp* node = (NodeBinOp*) n;
+                Type* l = sccp::value(s, node->lhs());
+                Type* r = sccp::value(s, node->rhs());
+                if(l == type::pool.top || r == type::pool.top) return type::pool.top;
+                if(!sccp::is_int_const(l) || !sccp::is_int_const(r) || !sccp::foldable(node->op)) return type::pool.bottom;
+                return type::pool.int_const(op::apply(node->op, ((TypeInt*) l)->val(), ((TypeInt*) r)->val()));
+            }
+
+            case NodeType::UnOp: {
+                NodeUnOp* node = (NodeUnOp*) n;
+                Type* r = sccp::value(s, node->rhs());
+                if(r == type::pool.top) return type::pool.top;
+                if(!sccp::is_int_const(r) || !sccp::foldable(node->op)) return type::pool.bottom;
+                return type::pool.int_const(op::apply(node->op, ((TypeInt*) r)->val()));
+            }
+
+            default:
+                // projections of the arguments, memory ops, etc
+                return n->cfg() ? sccp::value(s, n->input[0]) : type::pool.bottom;
+        }
+    }
+
+    // run the analysis to a fixpoint
+    void analyze(State& s, Node* start, Stats& stats, mem::Arena& scratch) {
+        Vec<Node*> work = Vec<Node*>::create(scratch);
+        BitSet on = BitSet::create(Node::uid_counter + 1, scratch);
+        work.push(start); on.set(start->uid);
+        while(!work.empty()) {
+            Node* n = work.pop();
+            on.unset(n->uid);
+            stats.iterations++;
+            if(n->type == nullptr || n->nt == NodeType::Scope) continue;
+            Type* t = sccp::transfer(s, n);
+            if(t == sccp::value(s, n)) continue;
+            s.vals[n->uid] = t;
+            for(Node* out : n->output) {
+                if(!on[out->uid]) { on.set(out->uid); work.push(out); }
+                // some nodes look past their direct inputs, so they have to be revisited even if those didn't change:
+                // a newly reachable edge into a region changes its phis, and a new condition changes the projections of an `If`
+                if((n->cfg() && (out->nt == NodeType::Region || out->nt == NodeType::Loop)) || out->nt == NodeType::If) {
+                    for(Node* next : out->output) {
+                        if(!on[next->uid]) { on.set(next->uid); work.push(next); }
+                    }
+                }
+            }
+        }
+    }
+
+    // everything reachable from `start` through outputs, in depth first preorder
+    // iterative, since the graph can get deep
+    void collect(Node* start, Vec<Node*>& all, mem::Arena& scratch) {
+        struct Frame {
+            Node* n;
+            u32 next; // index of the next output to visit
+        };
+        Vec<Frame> stack = Vec<Frame>::create(scratch);
+        BitSet visit = BitSet::create(Node::uid_counter + 1, scratch);
+        visit.set(start->uid);
+        all.push(start);
+        stack.push(Frame { .n = start, .next = 0 });
+        while(!stack.empty()) {
+            Frame& f = stack.back();
+            if(f.next == f.n->output.size) { stack.pop(); continue; }
+            Node* out = f.n->output[f.next++];
+            if(visit[out->uid]) continue;
+            visit.set(out->uid);
+            all.push(out);
+            stack.push(Frame { .n = out, .next = 0 });
+        }
+    }
+
+    // mark everything reachable from `n` through inputs
+    void mark_live(Node* n, BitSet& live, mem::Arena& scratch) {
+        if(live[n->uid]) return;
+        Vec<Node*> work = Vec<Node*>::create(scratch);
+        live.set(n->uid);
+        work.push(n);
+        while(!work.empty()) {
+            Node* next = work.pop();
+            for(Node* in : next->input) {
+                if(in == nullptr || live[in->uid]) continue;
+                live.set(in->uid);
+                work.push(in);
+            }
+        }
+    }
+
+    // drop the dead inputs of a reachable merge point (and the matching phi columns)
+    void prune_region(State& s, Node* region) {
+        for(u32 i = region->input.size; i-- > 0;) {
+            if(sccp::reachable(s, region->input[i])) continue;
+            if(region->nt != NodeType::Stop) {
+                for(Node* phi : region->output) {
+                    if(phi->nt == NodeType::Phi) phi->remove_input(i+1);
+                }
+            }
+            region->remove_input(i);
+        }
+    }
+
+    // replace a region with a single input by that input
+    void collapse_region(Node* region) {
+        for(u32 i = 0; i < region->output.size;) {
+            Node* phi = region->output[i];
+            Node* in = phi->nt == NodeType::Phi ? ((NodePhi*) phi)->data(0) : nullptr;
+            if(in == nullptr || in == phi) { i++; continue; } // not a phi, or only feeds itself (the sweep will get it)
+            phi->subsume(in);
+            i = 0; // killing the phi may have killed other outputs too
+        }
+        region->subsume(region->input[0]);
+    }
+
+    // replace an `If` that only has one reachable side by its ctrl
+    bool collapse_if(State& s, NodeIf* node) {
+        Node* live = nullptr;
+        for(Node* out : node->self.output) {
+            if(out->nt != NodeType::CtrlProj) continue;
+            if(sccp::reachable(s, out)) {
+                if(live != nullptr) return false; // both sides are reachable
+                live = out;
+            }
+        }
+        if(live == nullptr) return false;
+        live->subsume(node->ctrl());
+        return true;
+    }
+
+    // remove everything that's not reachable from `stop` through inputs; anything left is dead code
+    void sweep(Node* start, Node* stop, Stats& stats, mem::Arena& scratch) {
+        Vec<Node*> all = Vec<Node*>::create(scratch);
+        sccp::collect(start, all, scratch);
+        BitSet live = BitSet::create(Node::uid_counter + 1, scratch);
+        sccp::mark_live(stop, live, scratch);
+        for(Node* n : all) {
+            if(n->nt == NodeType::Scope) sccp::mark_live(n, live, scratch); // not a part of the program, but still holds on to its inputs
+        }
+        // dead nodes may use each other in cycles, so cut every edge instead of `Node::kill`
+        // first detach them from the live nodes they use, then drop the edges among themselves
+        for(Node* n : all) {
+            if(live[n->uid] || n->type == nullptr) continue;
+            n->unlock();
+            for(u32 i = 0; i < n->input.size; i++) {
+                if(n->input[i] != nullptr && live[n->input[i]->uid]) n->remove_use(i);
+            }
+        }
+        for(Node* n : all) {
+            if(live[n->uid] || n->type == nullptr) continue;
+            n->input.clear();
+            n->output.clear();
+            n->type = nullptr;
+            stats.swept++;
+        }
+    }
+
+    Stats run(Node* start, Node* stop) {
+        Stats stats {};
+        #ifdef NOOPTS
+        return stats;
+        #endif
+        mem::Scratch scratch;
+        State s { .size = Node::uid_counter + 1 };
+        s.vals = scratch.arena->alloc<Type*>(s.size);
+        mem::zero(s.vals, s.size);
+        sccp::analyze(s, start, stats, *scratch.arena);
+
+        Vec<Node*> all = Vec<Node*>::create(*scratch.arena);
+        sccp::collect(start, all, *scratch.arena);
+
+        // fold constants
+        for(Node* n : all) {
+            if(n->type == nullptr || n->cfg() || n->keepalive) continue;
+            if(n->nt == NodeType::Const || n->nt == NodeType::Scope) continue;
+            Type* t = sccp::value(s, n);
+            if(!sccp::is_int_const(t)) continue;
+            n->subsume(NodeConst::create(t));
+            stats.constants++;
+        }
+
+        // cut the edges coming from dead paths into merge points
+        for(Node* n : all) {
+            if(n->type == nullptr || !sccp::reachable(s, n)) continue;
+            if(n->nt == NodeType::Region || n->nt == NodeType::Loop || n->nt == NodeType::Stop)
+                sccp::prune_region(s, n);
+        }
+        for(Node* n : all) {
+            if(n->type == nullptr || !sccp::reachable(s, n)) continue;
+            if(n->nt == NodeType::If && sccp::collapse_if(s, (NodeIf*) n)) stats.branches++;
+        }
+        for(Node* n : all) {
+            if(n->type == nullptr || !sccp::reachable(s, n)) continue;
+            if((n->nt == NodeType::Region || n->nt == NodeType::Loop) && n->input.size == 1)
+                sccp::collapse_region(n);
+        }
+
+        sccp::sweep(start, stop, stats, *scratch.arena);
+        return stats;
+    }
+
+    // in the namespace, so `profile::note` finds it
+    std::ostream& operator<<(std::ostream& os, Stats const& stats) {
+        return os << stats.iterations << " iterations, " << stats.constants << " constants, " << stats.branches << " branches, " << stats.swept << " nodes swept";
+    }
+}
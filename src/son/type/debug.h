@@ -79,9 +79,9 @@ namespace type {
                 else if(ty->self.tinfo == TypeI::Bottom) 
                     return "Float:Bottom"_s;
                 else if(ty->val_min == ty->val_max)
-                    return str::from_slice_of_str(ref(Vec<Str>::with("Float:"_s, "UNIMPLEMENTED"_s).full_slice()));
+                    return str::from_slice_of_str(ref(Vec<Str>::with("Float:"_s, str::from_float(ty->val_min)).full_slice()));
                 else
-                    return str::from_slice_of_str(ref(Vec<Str>::with("Float:"_s, "UNIMPLEMENTED"_s, "..="_s, "UNIMPLEMENTED"_s).full_slice()));
+                    return str::from_slice_of_str(ref(Vec<Str>::with("Float:"_s, str::from_float(ty->val_min), "..="_s, str::from_float(ty->val_max)).full_slice()));
             }
 
             case TypeT::Tuple: {
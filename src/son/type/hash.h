@@ -9,7 +9,7 @@
 #include "type_def.h"
 #include "type_pool.h"
 
-#define defhash (hash::from(t->tinfo) ^ hash::from(t->ttype) * 3)
+#define defhash hash::combine(hash::from(t->tinfo), hash::from(t->ttype))
 
 namespace type {
     u64 hash(Type* t) {
@@ -23,28 +23,23 @@ namespace type {
             case TypeT::Bool:
             case TypeT::Int: {
                 TypeInt* ty = reinterpret_cast<TypeInt*>(t);
-                return defhash ^ 
-                    std::rotl(hash::from(ty->val_min), 8) ^ std::rotl(hash::from(ty->val_max), 16);
+                return hash::combine(defhash, hash::from(ty->val_min), hash::from(ty->val_max));
             }
 
             case TypeT::Float: {
                 TypeFloat* ty = reinterpret_cast<TypeFloat*>(t);
-                return defhash ^ 
-                    std::rotl(hash::from(ty->val_min), 8) ^ std::rotl(hash::from(ty->val_max), 16);
+                return hash::combine(defhash, hash::from(ty->val_min), hash::from(ty->val_max));
             }
 
             case TypeT::Tuple: {
                 TypeTuple* ty = reinterpret_cast<TypeTuple*>(t);
-                return defhash ^ 
-                    std::rotl(hash::from(ty->val), 16);
+                return hash::combine(defhash, hash::from(ty->val));
             }
 
             case TypeT::Mem:
             case TypeT::Ptr: {
                 TypePtr* ty = reinterpret_cast<TypePtr*>(t);
-                return defhash ^ 
-                    (ty->ptr == nullptr ? 0 : std::rotl(type::hash(ty->ptr), 16)) ^
-                    std::rotl(hash::from(ty->size), 48);
+                return hash::combine(defhash, ty->ptr == nullptr ? 0 : type::hash(ty->ptr), hash::from(ty->size));
             }
         }
         unreachable;
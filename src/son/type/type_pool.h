@@ -31,6 +31,11 @@ struct TypePool {
         };
     }
 
+    // number of distinct types made so far
+    u32 size() {
+        return 4 + s_type_int.size + s_type_float.size + s_type_tuple.size + s_type_ptr.size;
+    }
+
     Type* get_bottom(TypeT tt) {
         Type t = Type { .tinfo=TypeI::Bottom, .ttype=tt };
         switch(tt) {
@@ -143,5 +148,5 @@ struct TypePool {
 };
 
 namespace type {
-    static TypePool pool;
+    static thread_local TypePool pool;
 };
\ No newline at end of file
@@ -1,8 +1,28 @@
 #include "core/prelude.h"
 #include "core/bitset.h"
+#include "core/map.h"
+#include "core/pvec.h"
+#include "core/smallvec.h"
+#include "core/vec.h"
+#include "lang/number.h"
+#include "token/token_stream.h"
+#include "compile/context.h"
+
+#include <sstream>
 
 #define print(one) { std::cout << one << std::endl; }
 
+// compile `src` and run it with `arg`; what the program returned, or the errors if it didn't compile
+std::string run(char const* src, char const* arg) {
+    CompilationContext ctx = CompilationContext::create();
+    Source source = Source::from_str(str::from_cstr(src));
+    std::ostringstream out;
+    if(!ctx.compile(source.text, CompilationContext::Options { .program_input = arg, .dot_path = nullptr }, out)) return out.str();
+    std::string s = out.str();
+    usize at = s.find("Program output: ") + 16;
+    return s.substr(at, s.find('\n', at) - at);
+}
+
 int main(int argc, char* argv[]) {
     BitSet bs = BitSet::create();
     print(bs);
@@ -14,4 +34,145 @@ int main(int argc, char* argv[]) {
     print(bs);
     bs.toggle(100);
     print(bs);
-}
\ No newline at end of file
+    BitSet other = BitSet::create(200);
+    other.set(7);
+    other.set(150);
+    bs |= other;
+    print(bs.popcount());
+    bs -= other;
+    print(bs);
+    other &= bs;
+    print(other.empty());
+
+    mem::Arena arena = mem::Arena::create_chunked(1 KB);
+    u64* first = arena.alloc<u64>(64);
+    mem::Arena::Mark m = arena.mark();
+    for(u32 i = 0; i < 100; i++) arena.alloc<u64>(64); // way past the first chunk
+    print(arena.used());
+    arena.rewind(m);
+    print(arena.used());
+    print(arena.high_water_mark());
+    first[63] = 1; // still valid after rewinding
+    print(first[63]);
+    static_assert(!std::is_copy_constructible_v<mem::Arena>);
+    mem::Arena moved_from = mem::Arena::create_chunked(1 KB);
+    u64* kept = moved_from.alloc<u64>(1);
+    *kept = 7;
+    mem::Arena moved_to = std::move(moved_from); // the chunks go along, and are freed once
+    print((moved_from.chunk == nullptr) << " " << *kept << " " << moved_to.used());
+
+    HMap<u64,u64> map = HMap<u64,u64>::create();
+    for(u64 i = 0; i < 10000; i++) {
+        map.add(i, i*i);
+        if(i >= 8) map.remove(i-8); // churn; tombstones must not pile up
+    }
+    print(map.size);
+    print(map.capacity);
+    print(map[9999]);
+    print(map.exists(9991));
+
+    PVec<u32> a = PVec<u32>::create();
+    for(u32 i = 0; i < 2000; i++) a.push(i);
+    PVec<u32> b = a.clone();
+    b.set(1500, 0);
+    b.push(2000);
+    print(a[1500]);
+    print(b[1500]);
+    print(a.size);
+    print(b.size);
+
+    SmallVec<u32, 4> small = SmallVec<u32, 4>::create(arena);
+    for(u32 i = 0; i < 4; i++) small.push(i);
+    print(small.is_inline());
+    small.push(4);
+    print(small.is_inline());
+    print(small[4]);
+    SmallVec<u32, 4> self_push = SmallVec<u32, 4>::create(arena);
+    for(u32 i = 1; i <= 4; i++) self_push.push(i);
+    self_push.push(self_push[0]); // the element moves to the heap under `push`
+    print(self_push[4]);
+    SmallVec<u32, 4> small_copy = small.clone();
+    small_copy[4] = 40;
+    print(small[4] << " " << small_copy[4]);
+    SmallVec<u32, 4> moved = std::move(small);
+    print(moved.size << " " << small.size);
+
+    // a grown buffer is handed to the next vector that needs one of its size
+    Vec<u64> grown = Vec<u64>::create(arena);
+    for(u64 i = 0; i < 8; i++) grown.push(i);
+    arena.alloc<u64>(1); // `grown` is no longer the last allocation, so it can't grow in place
+    u64* old_data = grown.data;
+    grown.push(8);
+    Vec<u64> next = Vec<u64>::create(arena);
+    next.reserve(8);
+    print((next.data == old_data));
+    Vec<u64> self_grow = Vec<u64>::create(arena);
+    for(u64 i = 1; i <= 8; i++) self_grow.push(i);
+    arena.alloc<u64>(1);
+    self_grow.push(self_grow[0]); // the old buffer is reused (and written to) as soon as it's released
+    print(self_grow[8]);
+
+    // integer literals: `here` is false if it's malformed or doesn't fit in 64 bits
+    for(Str lit : { "0"_s, "12345678901234567"_s, "18446744073709551615"_s, "18446744073709551616"_s, "0xFFFFFFFFFFFFFFFF"_s,
+                    "0x10000000000000000"_s, "0b101"_s, "0x"_s, "0b102"_s }) {
+        Maybe<u64> v = num::parse_int(lit);
+        print(lit << " " << v.here << " " << v.val);
+    }
+
+    // streaming a source with tiny chunks gives the same tokens as lexing it whole: tokens cut off at the end of a chunk
+    // (including `1.` and `1e` that need a lookahead past it) are lexed again, and a name longer than a chunk grows them
+    sym::table = SymbolTable::create(arena);
+    Str sample = "let a_much_longer_name_than_any_chunk: i64 = 12.5e-3 + 0x1F; ## a\n block ## x = \"str\" # c\n"
+                 "while(x < 1e5) { x = x * 2.; };\nreturn a_much_longer_name_than_any_chunk - x;\n"_s;
+    Source whole = Source::from_str(sample, arena);
+    u32 mismatches = 0;
+    usize retired = 0; // chunks still pinned at the end
+    for(usize chunk_size : { 1, 2, 3, 5, 7, 16, 61 }) {
+        i32 pipe_fds[2];
+        if(::pipe(pipe_fds) != 0 || ::write(pipe_fds[1], sample.data, sample.size) != (i64) sample.size) panic;
+        ::close(pipe_fds[1]);
+        TokenStream full = TokenStream::lex(whole.text, arena);
+        ChunkReader reader = ChunkReader::create(pipe_fds[0], chunk_size, arena);
+        TokenStream streamed = TokenStream::stream(&reader, arena);
+        for(u32 i = 0; true; i++) {
+            Token a = full.next(), b = streamed.next();
+            if(a.tt != b.tt || a.val != b.val || (a.tt == TokenType::Identifier && a.sym != b.sym)) mismatches++;
+            if(i % 3 == 0) streamed.release(); // frees the chunks the released tokens were in
+            if(a.tt == TokenType::EndOfFile) break;
+        }
+        streamed.release();
+        retired += reader.retired.size;
+        reader.close();
+    }
+    sym::table.copy_names = nullptr;
+    print(mismatches);
+    print(retired);
+
+    // code after a `return` (or `break`, or `continue`) is unreachable, and so are the ctrl nodes it would need
+    for(char const* src : { "if(arg == 1) { return 1; } else { return 3; };\nreturn 2;",
+                            "return 1;\nwhile(arg){ arg = 1; };",
+                            "if(arg==1){ return 1; if(arg){ arg = 2; }; };\nreturn 2;",
+                            "while(arg < 5) { return 4; };\nreturn arg;",
+                            "while(arg < 5) { arg = arg + 1; break; };\nreturn arg;",
+                            "let x: i64 = 0; while(x < 5) { x = x + arg; if(x > 3) { break; } else { continue; }; };\nreturn x;" }) {
+        print(run(src, "1") << " " << run(src, "3"));
+    }
+
+    // a variable only assigned in a loop still needs a phi there, or it has its last value even if the loop never ran
+    for(char const* src : { "let i: i64 = arg; let a: i64 = 1; while(i) { a = 2; i = i - 1; };\nreturn a;",
+                            "let a: i64 = 1; while(a < 3) { while(arg) { a = 5; arg = 0; }; a = a + 1; };\nreturn a;",
+                            "let a: i64 = 1; while(a < 3) { while(arg) { return a; }; a = a + 1; };\nreturn a;" }) {
+        print(run(src, "0") << " " << run(src, "1"));
+    }
+
+    // bad input gets diagnostics, whatever it is
+    for(char const* src : { "let x: i64 = [1];\nreturn 1;",
+                            "let >= while #c\n break 1 arg if ( 1 >= = * if y",
+                            "let a while a while return 2 ; }",
+                            "let x: i64 = 1.5;\nreturn x * 2e3;",
+                            "let x: i64 = arg.y;\nlet y: i64 = arg(1);\nlet z: i64 = { 1 };\nreturn if(arg) { 1; };" }) {
+        std::string out = run(src, "1");
+        out.pop_back();
+        print(out.substr(out.rfind('\n') + 1)); // the error count
+    }
+}
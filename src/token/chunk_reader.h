@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/mem.h"
+#include "../core/str.h"
+#include "../core/vec.h"
+
+#include "source.h"
+
+#include <cerrno>
+
+// Reads a file descriptor a chunk at a time, for sources too big to have in memory at once
+// Each chunk is padded like a `Source`, so the tokenizer runs on it unchanged. A token that's cut off by the end of a
+// chunk is lexed again from the next one: `advance` starts the new chunk with the old one's unfinished tail.
+// Tokens point into the chunks, so a chunk is pinned until every token lexed out of it has been released (the parser
+// releases at statement boundaries); only then is it freed.
+struct ChunkReader {
+    struct Chunk {
+        u8* data; // owned; `size` bytes of source followed by `Source::PADDING` zeros
+        usize size;
+        usize capacity; // not counting the padding
+        u64 last_token; // global index of the last token lexed out of it; `NONE` if there's none
+    };
+
+    static constexpr u64 NONE = U64_MAX;
+    static constexpr usize DEFAULT_CHUNK_SIZE = 1 MB;
+
+    i32 fd; // owned
+    bool done; // everything has been read, or a read failed
+    i32 error; // errno of the read that failed; 0 if none did (the source is cut off if one did)
+    usize chunk_size;
+    Chunk current;
+    u64 base; // where `current` starts in the file
+    usize at; // where lexing continues in `current`
+    bool carry; // the token at `at` might be cut off; `advance(at)` before lexing on
+    Vec<Chunk> retired; // chunks before `current` that are still pinned
+    u64 released; // tokens before this global index are no longer referenced
+
+    static ChunkReader create(i32 fd, usize chunk_size = DEFAULT_CHUNK_SIZE, mem::Arena& arena = default_arena) {
+        ChunkReader r {
+            .fd = fd,
+            .done = false,
+            .error = 0,
+            .chunk_size = chunk_size,
+            .current = ChunkReader::new_chunk(chunk_size),
+            .base = 0,
+            .at = 0,
+            .carry = false,
+            .retired = Vec<Chunk>::create(arena),
+            .released = 0,
+        };
+        r.fill();
+        return r;
+    }
+
+    static Chunk new_chunk(usize capacity) {
+        return Chunk { .data = mem::alloc<u8>(capacity + Source::PADDING), .size = 0, .capacity = capacity, .last_token = NONE };
+    }
+
+    Str text() {
+        return Str { .data = current.data, .size = current.size };
+    }
+
+    // read until `current` is full or the file ends
+    void fill() {
+        while(current.size < current.capacity && !done) {
+            i64 got = ::read(fd, current.data + current.size, current.capacity - current.size);
+            if(got < 0 && errno == EINTR) continue;
+            if(got < 0) error = errno;
+            if(got <= 0) { done = true; break; }
+            current.size += got;
+        }
+        mem::zero(current.data + current.size, Source::PADDING);
+    }
+
+    // start a new chunk with `current[from..]` and read as much as fits after it
+    void advance(usize from) {
+        usize tail = current.size - from;
+        Chunk next = ChunkReader::new_chunk(max(chunk_size, tail * 2)); // a token longer than a chunk grows them
+        mem::copy(next.data, current.data + from, tail);
+        next.size = tail;
+        if(current.last_token != NONE && current.last_token >= released) retired.push(current);
+        else mem::free(current.data);
+        current = next;
+        base += from;
+        at = 0;
+        carry = false;
+        this->fill();
+    }
+
+    // tokens before global index `upto` won't be looked at again; free the chunks only they pointed into
+    void release(u64 upto) {
+        released = max(released, upto);
+        usize kept = 0;
+        for(usize i = 0; i < retired.size; i++) {
+            if(retired[i].last_token < released) mem::free(retired[i].data);
+            else retired[kept++] = retired[i];
+        }
+        retired.size = kept;
+    }
+
+    void close() {
+        for(Chunk& c : retired) mem::free(c.data);
+        retired.clear();
+        mem::free(current.data);
+        current = Chunk {};
+        ::close(fd);
+    }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/mem.h"
+#include "../core/str.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Source text for the tokenizer
+// Every source is followed by at least `PADDING` zero bytes that aren't part of `text`, so the tokenizer can scan
+// without checking bounds: '\0' isn't whitespace, a digit, a letter or anything else a scanning loop continues on.
+// Big files are mapped straight into memory with the padding mapped in after them, so they're never copied; small ones
+// (and anything that isn't a regular file) are read into an arena, which is cheaper than setting up a mapping.
+// Tokens and interned names point into `text`, so keep the source alive (don't `close` it) until compilation is done.
+struct Source {
+    Str text;
+    u8* mapping; // nullable; owned when `text` is mapped
+    usize mapping_size;
+    bool ok; // false if the file couldn't be read; `text` is empty then
+
+    static constexpr usize PADDING = 64;
+    static constexpr usize MAP_MIN = 64 KB; // files smaller than this are read instead
+
+    // a padded copy of `s`; e.g. for generated programs
+    static Source from_str(Str s, mem::Arena& arena = default_arena) {
+        u8* data = arena.alloc<u8>(s.size + PADDING);
+        mem::copy(data, s.data, s.size);
+        mem::zero(data + s.size, PADDING);
+        return Source { .text = Str { .data = data, .size = s.size }, .ok = true };
+    }
+
+    static Source load(char const* path, mem::Arena& arena = default_arena) {
+        i32 fd = ::open(path, O_RDONLY);
+        if(fd < 0) {
+            printe("could not open", path);
+            return Source::from_str(""_s, arena).failed();
+        }
+        struct stat st;
+        bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode); // if fstat fails, read it like a pipe
+        Source s;
+        if(regular && (usize) st.st_size >= MAP_MIN) s = Source::map(fd, st.st_size);
+        else s = Source::read(fd, regular ? st.st_size : 0, arena);
+        ::close(fd);
+        if(!s.ok) printe("could not read", path);
+        return s;
+    }
+
+    // reserve room for the file and the padding, then map the file over the front of it
+    // the rest of the file's last page and everything after it are zero
+    static Source map(i32 fd, usize size) {
+        usize page = sysconf(_SC_PAGESIZE);
+        usize total = ceil_div(size + PADDING, page) * page;
+        void* base = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(base == MAP_FAILED) return Source::from_str(""_s).failed();
+        if(mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, total);
+            return Source::from_str(""_s).failed();
+        }
+        madvise(base, size, MADV_SEQUENTIAL);
+        return Source { .text = Str { .data = (u8*) base, .size = size }, .mapping = (u8*) base, .mapping_size = total, .ok = true };
+    }
+
+    // read until the end of the file; `size_hint` is where to start (0 for pipes and such)
+    static Source read(i32 fd, usize size_hint, mem::Arena& arena) {
+        usize capacity = max(size_hint, (usize) 4 KB) + PADDING;
+        u8* data = arena.alloc<u8>(capacity);
+        usize size = 0;
+        while(true) {
+            if(capacity - size < PADDING + 1) {
+                data = arena.realloc(data, capacity, capacity * 2);
+                capacity *= 2;
+            }
+            i64 got = ::read(fd, data + size, capacity - size - PADDING);
+            if(got < 0) return Source::from_str(""_s, arena).failed();
+            if(got == 0) break;
+            size += got;
+        }
+        mem::zero(data + size, PADDING);
+        return Source { .text = Str { .data = data, .size = size }, .ok = true };
+    }
+
+    Source failed() {
+        ok = false;
+        return *this;
+    }
+
+    // unmap it if it's mapped; arena copies go away with their arena
+    void close() {
+        if(mapping != nullptr) munmap(mapping, mapping_size);
+        mapping = nullptr;
+        text = Str { .data = nullptr, .size = 0 };
+    }
+};
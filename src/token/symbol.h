@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/str.h"
+#include "../core/vec.h"
+#include "../core/map.h"
+
+typedef u32 Sym; // dense id of an interned identifier
+
+// Symbol table; every distinct identifier gets the next id, in the order they are first seen
+// names are not copied, so they must outlive the table (source code and string literals do), unless `copy_names` is set
+struct SymbolTable {
+    HMap<Str,Sym> ids;
+    Vec<Str> names; // indexed by `Sym`
+    mem::Arena* copy_names; // nullable; new names are copied here (for sources that are freed as they're lexed)
+
+    static SymbolTable create(mem::Arena& arena = default_arena) {
+        return SymbolTable { .ids = HMap<Str,Sym>::create(&arena), .names = Vec<Str>::create(arena), .copy_names = nullptr };
+    }
+
+    Sym intern(Str name) {
+        u32 index = ids.find(name);
+        if(index != swiss::NONE) return ids.entries[index].value;
+        if(copy_names != nullptr) name = str::clone_str(name, *copy_names);
+        Sym id = names.size;
+        names.push(name);
+        ids.add(name, id);
+        return id;
+    }
+
+    Str name(Sym id) {
+        return names[id];
+    }
+
+    u32 size() {
+        return names.size;
+    }
+};
+
+namespace sym {
+    static thread_local SymbolTable table;
+
+    Sym intern(Str name) { return sym::table.intern(name); }
+    Str name(Sym id) { return sym::table.name(id); }
+};
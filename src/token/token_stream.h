@@ -0,0 +1,181 @@
+#pragma once
+
+#include "../core/prelude.h"
+#include "../core/str.h"
+#include "../core/vec.h"
+
+#include "tokenizer.h"
+#include "chunk_reader.h"
+
+// Every token of a source, lexed in one pass before parsing
+// Struct of arrays, so looking at the next token's kind (which is most of what the parser does) touches a byte, not a
+// whole `Token`. It always ends with a `TokenType::EndOfFile` token, which `next` never moves past.
+// A stream made with `stream` only holds a window of tokens out of one chunk of a `ChunkReader`; the next window is
+// lexed when the parser reaches the end of this one. Its tokens stay valid until the parser `release`s them.
+struct TokenStream {
+    Str source; // the current chunk when streaming
+    Vec<TokenType> kinds;
+    Vec<u32> offsets; // into `source`
+    Vec<u32> lengths;
+    Vec<Sym> syms; // interned names; only meaningful for `TokenType::Identifier`
+    u32 pos; // index of the next token
+    ChunkReader* reader; // nullable; set when streaming
+    u64 first; // global index of the first token in the window
+
+    static constexpr u32 WINDOW = 4096; // tokens lexed at a time when streaming
+
+    // `src` has to be padded (see `Source`)
+    static TokenStream lex(Str src, mem::Arena& arena = default_arena) {
+        assert(src.size < U32_MAX);
+        TokenStream s {
+            .source = src,
+            .kinds = Vec<TokenType>::create(arena),
+            .offsets = Vec<u32>::create(arena),
+            .lengths = Vec<u32>::create(arena),
+            .syms = Vec<Sym>::create(arena),
+            .pos = 0,
+            .reader = nullptr,
+            .first = 0,
+        };
+        usize guess = src.size / 3 + 16; // a bit more than the sources we have need (one token per 3.5 to 4 bytes)
+        s.kinds.reserve(guess); s.offsets.reserve(guess); s.lengths.reserve(guess); s.syms.reserve(guess);
+        Tokenizer t = Tokenizer::create(src);
+        while(true) {
+            Token token = t.next_token();
+            s.kinds.push(token.tt);
+            s.offsets.push(token.tt == TokenType::EndOfFile ? src.size : token.val.data - src.data);
+            s.lengths.push(token.val.size);
+            s.syms.push(token.sym);
+            if(token.tt == TokenType::EndOfFile) break;
+        }
+        return s;
+    }
+
+    // lex `reader` a window at a time
+    // the chunks are freed as the parser goes, so interned names are copied onto `arena` (see `SymbolTable`)
+    static TokenStream stream(ChunkReader* reader, mem::Arena& arena = default_arena) {
+        TokenStream s {
+            .source = reader->text(),
+            .kinds = Vec<TokenType>::create(arena),
+            .offsets = Vec<u32>::create(arena),
+            .lengths = Vec<u32>::create(arena),
+            .syms = Vec<Sym>::create(arena),
+            .pos = 0,
+            .reader = reader,
+            .first = 0,
+        };
+        s.kinds.reserve(WINDOW); s.offsets.reserve(WINDOW); s.lengths.reserve(WINDOW); s.syms.reserve(WINDOW);
+        sym::table.copy_names = &arena;
+        s.fill();
+        return s;
+    }
+
+    // replace the window with the next tokens of the current chunk
+    // a token that reaches (or looks ahead past) the end of the chunk might be cut off; it starts the next chunk instead,
+    // and since a window only points into one chunk, that also ends the window (unless it's empty)
+    void fill() {
+        assert(reader != nullptr);
+        first += kinds.size;
+        kinds.clear(); offsets.clear(); lengths.clear(); syms.clear();
+        pos = 0;
+        if(reader->carry) reader->advance(reader->at);
+        source = reader->text();
+        assert(source.size < U32_MAX);
+        Tokenizer t = Tokenizer::create(source);
+        t.at = reader->at;
+        while(kinds.size < WINDOW) {
+            usize before = t.at;
+            Token token = t.next_token();
+            if(t.at + Tokenizer::LOOKAHEAD >= source.size && !reader->done) {
+                if(kinds.size > 0) {
+                    reader->at = before;
+                    reader->carry = true;
+                    return;
+                }
+                reader->advance(before);
+                source = reader->text();
+                assert(source.size < U32_MAX);
+                t = Tokenizer::create(source);
+                continue;
+            }
+            kinds.push(token.tt);
+            offsets.push(token.tt == TokenType::EndOfFile ? source.size : token.val.data - source.data);
+            lengths.push(token.val.size);
+            syms.push(token.sym);
+            reader->current.last_token = first + kinds.size - 1;
+            if(token.tt == TokenType::EndOfFile) break;
+        }
+        reader->at = t.at;
+    }
+
+    // the parser is done with every token before the next one; chunks only they point into can be freed
+    void release() {
+        if(reader != nullptr) reader->release(first + pos);
+    }
+
+    u32 size() const {
+        return kinds.size;
+    }
+
+    Token get(u32 i) {
+        return Token { .val = source.slice(offsets[i], lengths[i]), .tt = kinds[i], .sym = syms[i] };
+    }
+
+    /* Reading */
+
+    TokenType peek() {
+        if(pos == kinds.size) this->fill();
+        return kinds[pos];
+    }
+
+    Token peek_token() {
+        if(pos == kinds.size) this->fill();
+        return this->get(pos);
+    }
+
+    // whether the next token is exactly `val`; for operators and other `TokenType::Special`/`Undefined` tokens
+    bool peek_is(Str val) {
+        if(pos == kinds.size) this->fill();
+        return lengths[pos] == val.size && source.slice(offsets[pos], lengths[pos]) == val;
+    }
+
+    // whether the next token ends an expression: `)`, `]`, `}`, `;`, `,` or the end of the file
+    bool peek_terminal() {
+        if(pos == kinds.size) this->fill();
+        switch(kinds[pos]) {
+            case TokenType::RightParenthese:
+            case TokenType::RightBracket:
+            case TokenType::RightCurly:
+            case TokenType::EndOfLine:
+            case TokenType::Comma:
+            case TokenType::EndOfFile:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    Token next() {
+        if(pos == kinds.size) this->fill();
+        Token t = this->get(pos);
+        if(kinds[pos] != TokenType::EndOfFile) pos++;
+        return t;
+    }
+
+    bool eof() {
+        if(pos == kinds.size) this->fill();
+        return kinds[pos] == TokenType::EndOfFile;
+    }
+
+    // where the next token starts in `source`
+    usize offset() {
+        if(pos == kinds.size) this->fill();
+        return offsets[pos];
+    }
+
+    // where the next token starts in the whole source, streamed or not
+    u64 position() {
+        if(pos == kinds.size) this->fill();
+        return (reader != nullptr ? reader->base : 0) + offsets[pos];
+    }
+};
@@ -5,7 +5,14 @@
 
 #include "../lang/util.h"
 
-enum class TokenType {
+#include "symbol.h"
+#include "source.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum class TokenType : u8 {
     Undefined, EndOfFile, EndOfLine, Comma, // special identifiers
     IntLiteral, FloatLiteral, StringLiteral, // literals
     If, Else, While, VarDecl, FunctionDecl, Return, Break, Continue, // keywords (respective): `if`, `else`, `while`, `let`, `fn`, `return`, `break`, `continue`
@@ -16,6 +23,7 @@ enum class TokenType {
 struct Token {
     Str val;
     TokenType tt;
+    Sym sym; // interned `val`; only set for `TokenType::Identifier`
 
     static const Token eof;
     static const Token empty;
@@ -26,30 +34,67 @@ struct Token {
 const Token Token::empty = {}; // wtf c++
 const Token Token::eof { .val={ .data=nullptr, .size=0 }, .tt=TokenType::EndOfFile }; // wtf c++
 
-// `next_token`, `next_type` and `next_binary_op` are the only methods that should be called externally
+// `next_token` is the only method that should be called externally; the parser reads a whole `TokenStream` instead
 // `parse_*` methods will assume that `this` is already at the correct token and will consume that token, returning it as a slice
 // `next_*` methods will read the next token and return it (as a `Token`)
 // `skip_*` methods will consume some amount of characters and not return any slice
 struct Tokenizer {
-    Str source;
+    Str source; // followed by at least `Source::PADDING` zero bytes
     usize at;
 
+    static constexpr usize LOOKAHEAD = 2; // how far past the end of a token it may look to decide where the token ends
+
+    // `src` has to be padded; get it from a `Source`
     static Tokenizer create(Str src) {
         return Tokenizer { .source = src, .at = 0 };
     }
 
     void reset() { at = 0; }
 
-    // return '\0' if at end of file
+    // return '\0' if at end of file; no bounds check, since the source is padded with zeros
     // be careful at exclusive while loops (such as one in `Tokenizer::skip_comment()`)
-    u8 peek() { if(this->eof()) { return '\0'; } return source[at]; }
-    u8 peek_non_white() { this->skip_white(); while(this->is_at_comment()) { this->skip_comment(); this->skip_white(); } return this->peek(); }
+    u8 peek() { return source.data[at]; }
+    u8 peek_non_white() { this->skip_white_and_comment(); return this->peek(); }
     bool eof() { return at >= source.size; }
     bool is_at_comment() { return this->peek() == '#'; }
+
+    // index of the first `c` or '\0' at or after `from`; the padding guarantees there is one
+    // 16 bytes at a time with SSE2; reading past the '\0' stays inside the padding
+    usize find(usize from, u8 c) {
+        #if defined(__SSE2__)
+        __m128i needle = _mm_set1_epi8(c);
+        __m128i zero = _mm_setzero_si128();
+        while(true) {
+            __m128i chunk = _mm_loadu_si128((__m128i const*) (source.data + from));
+            u32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, needle), _mm_cmpeq_epi8(chunk, zero)));
+            if(mask != 0) return from + std::countr_zero(mask);
+            from += 16;
+        }
+        #else
+        while(source.data[from] != c && source.data[from] != '\0') from++;
+        return from;
+        #endif
+    }
+
     void skip_white() {
-        while(ch::white(this->peek())) {
+        // most runs are a space or a newline and some indentation, which aren't worth a vector load
+        for(u32 i = 0; i < 8; i++) {
+            if(!ch::white(this->peek())) return;
             at++;
         }
+        #if defined(__SSE2__)
+        while(true) {
+            __m128i chunk = _mm_loadu_si128((__m128i const*) (source.data + at));
+            __m128i white = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+            u32 mask = ~_mm_movemask_epi8(white) & 0xFFFF; // non-white bytes
+            if(mask != 0) { at += std::countr_zero(mask); return; }
+            at += 16;
+        }
+        #else
+        while(ch::white(this->peek())) at++;
+        #endif
     }
     void skip_comment() {
         if(!is_at_comment()) return;
@@ -57,20 +102,18 @@ struct Tokenizer {
         if(this->peek() == '#') {
             // this is a comment block, read until ##
             at++; // skip the second #
-            bool can_end = false;
-            while(!this->eof()) {
-                if(this->peek() == '#') {
-                    if(can_end) { at++; return; }
-                    else { can_end = true; }
-                } else {
-                    can_end = false;
-                }
-                at++;
+            while(true) {
+                at = this->find(at, '#');
+                if(this->eof()) return;
+                if(source.data[at] == '#' && source.data[at+1] == '#') { at += 2; return; }
+                at++; // a single #, or a '\0' in the middle of the file
             }
         } else {
             // this is a line comment, read until newline
-            while(!this->eof() && this->peek() != '\n') {
-                at++;
+            while(true) {
+                at = this->find(at, '\n');
+                if(this->eof() || source.data[at] == '\n') return;
+                at++; // a '\0' in the middle of the file
             }
         }
     }
@@ -85,17 +128,34 @@ struct Tokenizer {
 
     // upon call, expected to have `source[at]` to be the first character of the number literal
     // after being called, `source[at]` will be the character right after the number literal
-    // CANNOT PARSE METHODS OF NUMBER LITERALS
-    Str parse_number_literal() {
+    // `0x` hex and `0b` binary literals are integers; anything with a fraction (`.` and a digit) or an exponent is a float
+    // the value isn't parsed here (see `num::parse_int`)
+    Token next_number() {
         assert(ch::num(source[at]));
         usize start = at;
+        if(this->peek() == '0' && ((source.data[at + 1] | 0x20) == 'x' || (source.data[at + 1] | 0x20) == 'b')) {
+            at += 2;
+            while(ch::hex(this->peek())) { at++; }
+            return Token { source.slice_range(start, at), TokenType::IntLiteral };
+        }
+        TokenType tt = TokenType::IntLiteral;
         while(ch::num(this->peek())) { at++; }
-        if(this->peek() == '.') {
-            // assume it's a float
+        // a `.` that isn't followed by a digit is left alone, so `1.method` can mean something one day
+        if(this->peek() == '.' && ch::num(source.data[at + 1])) {
+            tt = TokenType::FloatLiteral;
             at++;
             while(ch::num(this->peek())) { at++; }
         }
-        return source.slice_range(start, at);
+        if((this->peek() | 0x20) == 'e') {
+            u8 after = source.data[at + 1];
+            usize digits = (after == '+' || after == '-') ? at + 2 : at + 1;
+            if(ch::num(source.data[digits])) {
+                tt = TokenType::FloatLiteral;
+                at = digits;
+                while(ch::num(this->peek())) { at++; }
+            }
+        }
+        return Token { source.slice_range(start, at), tt };
     }
 
     // upon call, expected to have `source[at]` to be the first character of the identifier
@@ -114,60 +174,59 @@ struct Tokenizer {
         usize start = at;
         at++;
         while(!this->eof() && this->peek() != '"') { if(this->peek() == '\\') { at++; } at++; }
-        at++;
+        at = min(at + 1, source.size); // past the closing `"`, if there is one
         return source.slice_range(start, at);
     }
 
-    // upon call, expected to have `source[at]` to be the beginning of a type
-    // after being called, `source[at]` will be the character right after end of the type
-    Str parse_type() {
-        Str base = this->parse_identifier();
-        // // type can be followed by *
-        // while(this->peek_non_white() == '*') { at++; base.size++; } // very unintended by the `Str`, but should be safe here
-        // while(this->peek_non_white() == '[') {
-        //     at++; // consume [
-        //     Str inner = this->parse_number_literal();
-        //     if(this->peek_non_white() != ']') panic; // TODO do better error handling
-        //     at++; // consume ]
-        // }
-        return base;
-    }
-
     Token next_bracket() {
         Token t { source.slice(at, 1) };
         at++;
-        if(t.val[0] == '(') t.tt = TokenType::LeftParenthese;
-        else if(t.val[0] == ')') t.tt = TokenType::RightParenthese;
-        else if(t.val[0] == '[') t.tt = TokenType::LeftBracket;
-        else if(t.val[0] == ']') t.tt = TokenType::RightBracket;
-        else if(t.val[0] == '{') t.tt = TokenType::LeftCurly;
-        else if(t.val[0] == '}') t.tt = TokenType::RightCurly;
-        else panic;
+        switch(t.val[0]) {
+            case '(': t.tt = TokenType::LeftParenthese; break;
+            case ')': t.tt = TokenType::RightParenthese; break;
+            case '[': t.tt = TokenType::LeftBracket; break;
+            case ']': t.tt = TokenType::RightBracket; break;
+            case '{': t.tt = TokenType::LeftCurly; break;
+            case '}': t.tt = TokenType::RightCurly; break;
+            default: panic;
+        }
         return t;
     }
 
-    Token next_unary_op() {
-        this->skip_white_and_comment();
-        // if(this->eof()) return Token { source.slice(at, 0), TokenType::EndOfFile }; // TODO delete
-        if(this->eof()) return Token::eof;
-        // always single symbol
-        switch(this->peek()) {
-            case '-':
-            case '!':
-            case '~':
-            case '&':
-            case '*':
-                return Token { .val=source.slice(at++, 1), .tt=TokenType::Special };
-            default:
-                return Token { .val=source.slice(at++, 1), .tt=TokenType::Undefined };
+    // `kw` as a little endian word; at most 8 characters
+    static constexpr u64 word(char const* kw) {
+        u64 w = 0;
+        for(u32 i = 0; kw[i] != '\0'; i++) w |= (u64) (u8) kw[i] << (8 * i);
+        return w;
+    }
+
+    // the keyword `s` is, or `TokenType::Identifier`
+    // `s` has to be in the (padded) source: it's read as a single word and switched on, so it's never compared byte by
+    // byte. An identifier can't have a '\0' in it, so a longer one never matches a shorter keyword.
+    static TokenType keyword(Str s) {
+        if(s.size < 2 || s.size > 8) return TokenType::Identifier;
+        u64 w;
+        std::memcpy(&w, s.data, 8);
+        w &= ~(u64) 0 >> (64 - 8 * s.size);
+        switch(w) {
+            case word("if"): return TokenType::If;
+            case word("else"): return TokenType::Else;
+            case word("while"): return TokenType::While;
+            case word("let"): return TokenType::VarDecl;
+            case word("fn"): return TokenType::FunctionDecl;
+            case word("return"): return TokenType::Return;
+            case word("break"): return TokenType::Break;
+            case word("continue"): return TokenType::Continue;
+            default: return TokenType::Identifier;
         }
     }
 
-    Token next_binary_op() {
-        this->skip_white_and_comment();
-        // if(this->eof()) return Token { source.slice(at, 0), TokenType::EndOfFile }; // TODO delete
-        if(this->eof()) return Token::eof;
-        switch(this->peek()) {
+    // an operator, as long as it can be (`<=` rather than `<`); unary or binary is up to the parser
+    // `TokenType::Special` if it's an operator, `TokenType::Undefined` (one character) if it's not
+    Token next_op() {
+        usize start = at;
+        u8 c = source.data[at++];
+        switch(c) {
             // single symbol
             case '+':
             case '-':
@@ -175,89 +234,52 @@ struct Tokenizer {
             case '/':
             case '%':
             case '^':
-                return Token { .val=source.slice(at++, 1), .tt=TokenType::Special };
+            case '~':
+                return Token { .val=source.slice(start, 1), .tt=TokenType::Special };
 
             // can be single or double symbol
             case '&':
             case '|':
-            case '=': {
-                usize start = at; at++;
-                if(this->peek() == source[start]) {
-                    at++;
-                    return Token { .val=source.slice(start, 2), .tt=TokenType::Special };
-                } else {
-                    return Token { .val=source.slice(start, 1), .tt=TokenType::Special };
-                }
-            }
+            case '=':
+                if(this->peek() == c) at++;
+                return Token { .val=source.slice_range(start, at), .tt=TokenType::Special };
 
             // can be followed by `=`
             case '<':
-            case '>': {
-                usize start = at; at++;
-                if(this->peek() == '=') {
-                    at++;
-                    return Token { .val=source.slice(start, 2), .tt=TokenType::Special };
-                } else {
-                    return Token { .val=source.slice(start, 1), .tt=TokenType::Special };
-                }
-            }
-
-            case '!': {
-                usize start = at; at++;
-                if(this->peek() == '=') {
-                    at++;
-                    return Token { .val=source.slice(start, 2), .tt=TokenType::Special };
-                } else {
-                    return Token { .val=source.slice(start, 1), .tt=TokenType::Undefined };
-                }
-            }
+            case '>':
+            case '!':
+                if(this->peek() == '=') at++;
+                return Token { .val=source.slice_range(start, at), .tt=TokenType::Special };
 
             default:
-                return Token { .val=source.slice(at++, 1), .tt=TokenType::Undefined };
+                return Token { .val=source.slice(start, 1), .tt=TokenType::Undefined };
         }
     }
 
-    Token next_type() {
-        this->skip_white_and_comment();
-        if(this->eof()) return Token::eof;
-        Token type_token = { this->parse_type(), TokenType::DataType };
-        return type_token;
-    }
-
-    // Cannot read a `TokenType::DataType` token type; if you expect a type to be read, use `Tokenizer::next_type()` instead
-    // Cannot read a binary operator; if you expect a binop to be read, use `Tokenizer::next_binary_op()` instead
+    // Types are read as identifiers (`TokenType::DataType` is never returned)
     Token next_token() {
         this->skip_white_and_comment();
         if(this->eof()) return Token::eof;
-        if(this->peek() == ';') {
-            return Token { source.slice(at++, 1), TokenType::EndOfLine };
-        }
-        if(this->peek() == ',') {
-            return Token { source.slice(at++, 1), TokenType::Comma };
+        u8 c = this->peek();
+        u8 cls = ch::classes[c];
+        if(cls & ch::Alpha) {
+            Str token_val = this->parse_identifier();
+            TokenType tt = Tokenizer::keyword(token_val);
+            if(tt != TokenType::Identifier) return Token { token_val, tt };
+            return Token { token_val, TokenType::Identifier, sym::intern(token_val) }; // generic identifier
         }
-        if(this->peek() == '"') {
-            return Token { this->parse_string_literal(), TokenType::StringLiteral };
+        if(cls & ch::Num) {
+            return this->next_number();
         }
-        if(ch::bracket(this->peek())) {
+        if(cls & ch::Bracket) {
             return this->next_bracket();
         }
-        if(ch::num(this->peek())) {
-            return Token { this->parse_number_literal(), TokenType::IntLiteral };
-        }
-        if(ch::alpha(this->peek())) {
-            Str token_val = this->parse_identifier();
-            if(token_val == "if"_s) return Token { token_val, TokenType::If };
-            if(token_val == "else"_s) return Token { token_val, TokenType::Else };
-            if(token_val == "while"_s) return Token { token_val, TokenType::While };
-            if(token_val == "let"_s) return Token { token_val, TokenType::VarDecl };
-            if(token_val == "fn"_s) return Token { token_val, TokenType::FunctionDecl };
-            if(token_val == "return"_s) return Token { token_val, TokenType::Return };
-            if(token_val == "break"_s) return Token { token_val, TokenType::Break };
-            if(token_val == "continue"_s) return Token { token_val, TokenType::Continue };
-            return Token { token_val, TokenType::Identifier }; // generic identifier
+        switch(c) {
+            case ';': return Token { source.slice(at++, 1), TokenType::EndOfLine };
+            case ',': return Token { source.slice(at++, 1), TokenType::Comma };
+            case '"': return Token { this->parse_string_literal(), TokenType::StringLiteral };
+            default: return this->next_op(); // assume an operator
         }
-        // assume an operator
-        return this->next_unary_op();
     }
 };
 